@@ -0,0 +1,59 @@
+// Throughput of VectorGrid::interpolate along random walks for the linear layout and several brick sizes.
+// Each walker moves half a grid spacing per step in a random direction, so consecutive interpolations touch
+// neighboring cells as in a propagation, while the walkers as a whole cover the grid.
+// Usage: benchmark-grid [number of grid points per direction, default 256]
+
+#include "grpropa/Grid.h"
+#include "grpropa/Random.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+using namespace grpropa;
+
+static const int nWalkers = 100;
+static const int nSteps = 100000;
+
+int main(int argc, char **argv) {
+    size_t N = (argc > 1) ? atoi(argv[1]) : 256;
+    double spacing = 1;
+
+    Random random;
+    random.seed(1);
+    ref_ptr<VectorGrid> grid = new VectorGrid(Vector3d(0.), N, spacing);
+    for (size_t ix = 0; ix < N; ix++)
+        for (size_t iy = 0; iy < N; iy++)
+            for (size_t iz = 0; iz < N; iz++)
+                grid->get(ix, iy, iz) = Vector3f(random.randVector());
+
+    // precomputed steps and starting points, identical for all layouts
+    std::vector<Vector3d> steps(4096), starts(nWalkers);
+    for (size_t i = 0; i < steps.size(); i++)
+        steps[i] = random.randVector() * 0.5 * spacing;
+    for (size_t i = 0; i < starts.size(); i++)
+        starts[i] = Vector3d(random.rand(), random.rand(), random.rand()) * (N * spacing);
+
+    printf("%lu^3 grid, %d walkers with %d steps\n", (unsigned long) N, nWalkers, nSteps);
+    printf("%10s %14s %22s\n", "brick size", "CPU time [s]", "interpolations / s");
+
+    size_t sizes[] = { 1, 2, 4, 8 };
+    for (int b = 0; b < 4; b++) {
+        grid->setBrickSize(sizes[b]);
+        Vector3f sum(0.);
+        std::clock_t start = std::clock();
+        for (int w = 0; w < nWalkers; w++) {
+            Vector3d position = starts[w];
+            for (int s = 0; s < nSteps; s++) {
+                position += steps[(w * 7919 + s) % steps.size()];
+                sum += grid->interpolate(position);
+            }
+        }
+        double cpu = double(std::clock() - start) / CLOCKS_PER_SEC;
+        // print the sum so that the loop is not optimized away, it is the same for all layouts
+        printf("%10lu %14.3f %22.4g   (%g)\n", (unsigned long) sizes[b], cpu, nWalkers * double(nSteps) / cpu,
+                sum.getR());
+    }
+    return 0;
+}
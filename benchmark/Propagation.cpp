@@ -0,0 +1,90 @@
+// Accuracy per CPU second of PropagationBP and PropagationCK for electrons in a turbulent field,
+// evaluated directly (TurbulentMagneticField) and baked onto a grid (MagneticFieldGrid).
+// For each tolerance the final positions after a fixed trajectory length are compared to a reference
+// computed with PropagationCK at a very small tolerance.
+
+#include "grpropa/module/PropagationBP.h"
+#include "grpropa/module/PropagationCK.h"
+#include "grpropa/magneticField/MagneticFieldGrid.h"
+#include "grpropa/magneticField/TurbulentMagneticField.h"
+#include "grpropa/GridTools.h"
+#include "grpropa/Random.h"
+#include "grpropa/Units.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <vector>
+
+using namespace grpropa;
+
+static const double distance = 20 * Mpc;
+static const double minStep = 1e-6 * Mpc;
+static const double maxStep = 1 * Mpc;
+static const int nParticles = 20;
+
+// final positions of electrons started at the origin in the given directions
+static std::vector<Vector3d> propagate(const Module &propagation, const std::vector<Vector3d> &directions) {
+    std::vector<Vector3d> positions;
+    for (size_t i = 0; i < directions.size(); i++) {
+        Candidate c;
+        c.current.setId(11);
+        c.current.setEnergy(1 * EeV);
+        c.current.setPosition(Vector3d(0.));
+        c.current.setDirection(directions[i]);
+        c.setNextStep(minStep);
+        double length = 0;
+        while (length < distance * (1 - 1e-12)) {
+            c.setNextStep(std::min(c.getNextStep(), distance - length));
+            propagation.process(&c);
+            length += c.getCurrentStep();
+        }
+        positions.push_back(c.current.getPosition());
+    }
+    return positions;
+}
+
+static void compare(const char *name, ref_ptr<MagneticField> field, const std::vector<Vector3d> &directions) {
+    printf("\n%s\n", name);
+    std::vector<Vector3d> reference = propagate(PropagationCK(field, 1e-11, minStep, 0.01 * Mpc), directions);
+    printf("%-14s %10s %14s %18s\n", "module", "tolerance", "CPU time [s]", "rms error [kpc]");
+
+    double tolerances[] = { 1e-2, 1e-3, 1e-4, 1e-5, 1e-6, 1e-7 };
+    for (int m = 0; m < 2; m++) {
+        for (int t = 0; t < 6; t++) {
+            std::vector<Vector3d> positions;
+            std::clock_t start = std::clock();
+            if (m == 0)
+                positions = propagate(PropagationCK(field, tolerances[t], minStep, maxStep), directions);
+            else
+                positions = propagate(PropagationBP(field, tolerances[t], minStep, maxStep), directions);
+            double cpu = double(std::clock() - start) / CLOCKS_PER_SEC;
+
+            double sum = 0;
+            for (size_t i = 0; i < positions.size(); i++)
+                sum += (positions[i] - reference[i]).getR2();
+            printf("%-14s %10.0e %14.4f %18.4g\n", m ? "PropagationBP" : "PropagationCK", tolerances[t], cpu,
+                    std::sqrt(sum / positions.size()) / kpc);
+        }
+    }
+}
+
+int main() {
+    Random random;
+    random.seed(1);
+    std::vector<Vector3d> directions;
+    for (int i = 0; i < nParticles; i++)
+        directions.push_back(random.randVector());
+
+    // 1 nG turbulence with wavelengths 0.25 - 5 Mpc, gyroradius of 1 EeV electrons about 1 Mpc
+    ref_ptr<TurbulentMagneticField> turbulence = new TurbulentMagneticField();
+    turbulence->setTurbulenceProperties(1 * nG, 0.25 * Mpc, 5 * Mpc, -11. / 3., 300);
+    turbulence->initialize(1);
+    compare("TurbulentMagneticField", turbulence, directions);
+
+    ref_ptr<VectorGrid> grid = new VectorGrid(Vector3d(-8 * Mpc), 128, 16 * Mpc / 128);
+    bakeMagneticField(grid, turbulence);
+    compare("MagneticFieldGrid", new MagneticFieldGrid(grid), directions);
+    return 0;
+}
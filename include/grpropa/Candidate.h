@@ -11,6 +11,9 @@
 
 namespace grpropa {
 
+class Module;
+class MagneticField;
+
 /**
  @class Candidate
  @brief All information about the cosmic ray.
@@ -33,11 +36,38 @@ private:
     bool active; /**< Active status */
     double weight; /**< Weight of the candidate */
     double redshift; /**< Current simulation time-point in terms of redshift z */
+    double previousRedshift; /**< Redshift at the start of the current step */
     double cosmicTime; /**< Time ellapsed since the Big Bang for this cosmological model */
     double timeOfEmission; /**< Time of emission */
     double trajectoryLength; /**< Comoving distance [m] the candidate has travelled so far */
     double currentStep; /**< Size of the currently performed step in [m] comoving units */
     double nextStep; /**< Proposed size of the next propagation step in [m] comoving units */
+    double stepError; /**< Error of the last accepted propagation step relative to the tolerance */
+
+    struct RateCache {
+        const Module *owner; /**< Module that cached the rate */
+        int id; /**< Particle ID the rate was calculated for */
+        double energy; /**< Energy the rate was calculated for */
+        double redshift; /**< Redshift the rate was calculated for */
+        double rate; /**< Cached interaction rate */
+    };
+    std::vector<RateCache> rateCache; /**< Interaction rates cached by the modules, one entry per module */
+
+    struct ScheduledInteraction {
+        const Module *owner; /**< Module that scheduled the interaction */
+        int id; /**< Particle ID the interaction was scheduled for */
+        double energy; /**< Redshift-corrected energy E / (1 + z) the interaction was scheduled for */
+        double trajectoryLength; /**< Trajectory length at which the interaction occurs */
+    };
+    std::vector<ScheduledInteraction> scheduledInteractions; /**< Interaction points sampled by the modules, one entry per module */
+
+    struct FieldCache {
+        const MagneticField *field; /**< Field the value belongs to */
+        Vector3d position; /**< Position the field was evaluated at */
+        Vector3d value; /**< Field value */
+    };
+    FieldCache fieldCache[2]; /**< Field values of the last two evaluations shared between modules, e.g. at the start and end of the step */
+    int fieldCacheNext; /**< Entry of the field cache to be replaced next */
 
 public:
     Candidate(int id = 0, double energy = 0, Vector3d position = Vector3d(0, 0, 0), Vector3d direction = Vector3d(-1, 0, 0), double z = 0, double weight = 1);
@@ -77,6 +107,23 @@ public:
     void setNextStep(double step);
     double getNextStep() const;
 
+    /**
+     Error of the last accepted propagation step relative to the tolerance, 1 before the first step.
+     Used by step size controllers with memory, see PropagationDP.
+     */
+    void setStepError(double error);
+    double getStepError() const;
+
+    /**
+     Moves the current state back to a point of the current step, e.g. where an observer or boundary surface was crossed.
+     @param fraction    fraction of the current step, 0 gives the previous and 1 the current state
+     Position, direction and (if the particle ID did not change) energy are interpolated linearly between the
+     previous and current state, trajectory length, cosmic time and current step are reduced accordingly.
+     If the redshift has already been advanced over the current step (see Redshift), it is recomputed for the
+     shortened step.
+     */
+    void interpolateCurrentState(double fraction);
+
     /**
      Sets weight of each candidate.
      Weight are calculated after interactions following Elmag.
@@ -89,6 +136,40 @@ public:
      */
     void limitNextStep(double step);
 
+    /**
+     Look up the interaction rate a module has cached for this candidate.
+     @param owner       module the rate belongs to
+     @param tolerance   maximum relative change of the energy and of (1 + z) for which the cached rate is reused
+     @param rate        the cached rate, only set if the lookup succeeds
+     Returns false if the module has not cached a rate yet, if the particle ID changed
+     or if energy or redshift moved by more than the tolerance.
+     */
+    bool getCachedRate(const Module *owner, double tolerance, double &rate) const;
+
+    /**
+     Cache an interaction rate for the current particle ID, energy and redshift.
+     @param owner       module the rate belongs to
+     @param rate        interaction rate to be cached
+     */
+    void setCachedRate(const Module *owner, double rate);
+
+    /**
+     Returns the trajectory length at which the interaction scheduled by a module occurs.
+     Returns false if there is none, or if the particle ID or the redshift-corrected energy E / (1 + z)
+     changed since it was scheduled, since the sampled interaction point is then invalid.
+     */
+    bool getScheduledInteraction(const Module *owner, double &trajectoryLength) const;
+    void setScheduledInteraction(const Module *owner, double trajectoryLength);
+    void clearScheduledInteraction(const Module *owner);
+
+    /**
+     Look up a magnetic field value another module has evaluated for this candidate.
+     Returns false unless the same field has been stored for exactly this position.
+     */
+    bool getCachedField(const MagneticField *field, const Vector3d &position, Vector3d &value) const;
+    /** Store a magnetic field value, e.g. at the end point of a propagation step, replacing the older of two entries */
+    void setCachedField(const MagneticField *field, const Vector3d &position, const Vector3d &value);
+
     void setProperty(const std::string &name, const std::string &value);
     bool getProperty(const std::string &name, std::string &value) const;
     bool removeProperty(const std::string &name);
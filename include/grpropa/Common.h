@@ -34,6 +34,16 @@ double interpolate(double x, const std::vector<double>& X, const std::vector<dou
 double interpolateEquidistant(double x, double lo, double hi,
 		const std::vector<double>& Y);
 
+// Single precision versions of interpolate and interpolate2d for tables stored as float
+double interpolate(double x, const std::vector<float>& X, const std::vector<float>& Y);
+double interpolate2d(double x, double y, const std::vector<float>& X, const std::vector<float>& Y, const std::vector<float>& Z);
+
+// Resample the columns of a table Z (X changing the fastest, one column per X.size() entries) from X onto newX.
+// If singlePrecision is set, newX and newZ are rounded to float precision.
+// Returns the maximum relative deviation of the resampled table from Z at the nodes X,
+// ignoring entries below 1e-6 of the maximum of their column.
+double resampleTable(const std::vector<double>& X, const std::vector<double>& Z, std::vector<double>& newX, std::vector<double>& newZ, bool singlePrecision = false);
+
 } // namespace grpropa
 
 #endif // GRPROPA_COMMON_H
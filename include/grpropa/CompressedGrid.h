@@ -0,0 +1,106 @@
+#ifndef GRPROPA_COMPRESSEDGRID_H
+#define GRPROPA_COMPRESSEDGRID_H
+
+#include "grpropa/Grid.h"
+
+#include <vector>
+
+namespace grpropa {
+
+/**
+ @class CompressedVectorGrid
+ @brief Vector grid with compressed values that are decoded to single precision on access
+
+ The grid is divided into bricks of B^3 grid points. The values of each brick are stored relative to the
+ largest vector component in the brick, either as half precision floats or as scaled 16 or 8 bit integers.
+ This needs 6 or 3 bytes per grid point plus one float per brick, instead of 12 bytes for a VectorGrid.
+ Geometry, trilinear interpolation and the periodic or reflective extension are the same as for a VectorGrid.
+ */
+class CompressedVectorGrid: public Referenced {
+public:
+    enum Encoding {
+        Half, Int16, Int8
+    };
+
+private:
+    std::vector<unsigned char> data; /**< Encoded vector components, bricks of B^3 grid points with z changing the fastest */
+    std::vector<float> scales; /**< Largest vector component per brick */
+    Encoding encoding;
+    size_t bytes; /**< Bytes per vector component */
+    size_t Nx, Ny, Nz; /**< Number of grid points */
+    size_t brickBits; /**< log2 of the brick size */
+    size_t NBx, NBy, NBz; /**< Number of bricks */
+    Vector3d origin; /**< Origin of the volume that is represented by the grid. */
+    Vector3d gridOrigin; /**< Grid origin */
+    double spacing; /**< Distance between grid points */
+    bool reflective; /**< If set to true, the grid is repeated reflectively instead of periodically */
+
+    void init(size_t brickSize);
+    size_t index(size_t ix, size_t iy, size_t iz) const;
+
+public:
+    /**
+     Empty grid, to be filled with encode, encodeBrick or loadGrid.
+     @param origin    Position of the lower left front corner of the volume
+     @param Nx        Number of grid points in x-direction
+     @param Ny        Number of grid points in y-direction
+     @param Nz        Number of grid points in z-direction
+     @param spacing   Spacing between grid points
+     @param encoding  Half, Int16 or Int8
+     @param brickSize Number of grid points per brick in each direction, a power of 2
+     */
+    CompressedVectorGrid(Vector3d origin, size_t Nx, size_t Ny, size_t Nz, double spacing, Encoding encoding = Half, size_t brickSize = 4);
+
+    /** Compressed copy of a VectorGrid with the same geometry and extension */
+    CompressedVectorGrid(ref_ptr<VectorGrid> grid, Encoding encoding = Half, size_t brickSize = 4);
+
+    /** Encode all values of a VectorGrid of the same size */
+    void encode(ref_ptr<VectorGrid> grid);
+
+    /**
+     Encode the values of brick (bx, by, bz).
+     The B^3 values are given with the z-index changing the fastest; values outside of the grid are ignored.
+     */
+    void encodeBrick(size_t bx, size_t by, size_t bz, const Vector3f *values);
+
+    /** Decoded value of a grid point */
+    Vector3f get(size_t ix, size_t iy, size_t iz) const;
+
+    /** Decoded value of the grid point that is closest to a given position */
+    Vector3f closestValue(const Vector3d &position) const;
+
+    /** Interpolate the decoded grid at a given position */
+    Vector3f interpolate(const Vector3d &position) const;
+
+    /** RMS of the difference between the decoded values and the values of a VectorGrid of the same size */
+    double rmsError(ref_ptr<VectorGrid> grid) const;
+
+    /** Largest difference between the decoded values and the values of a VectorGrid of the same size */
+    double maxError(ref_ptr<VectorGrid> grid) const;
+
+    void setReflective(bool b);
+    bool isReflective() const;
+    Vector3d getOrigin() const;
+    size_t getNx() const;
+    size_t getNy() const;
+    size_t getNz() const;
+    double getSpacing() const;
+    size_t getBrickSize() const;
+    Encoding getEncoding() const;
+
+    /** Memory used by the encoded values and scale factors in bytes */
+    size_t getMemorySize() const;
+
+    /** Bytes per encoded value */
+    static size_t getBytesPerValue(Encoding encoding);
+
+    /** Encode n values relative to the largest absolute value, which is returned as the scale */
+    static float encodeValues(Encoding encoding, const float *values, size_t n, unsigned char *data);
+
+    /** Decode n values that were encoded with the given scale */
+    static void decodeValues(Encoding encoding, const unsigned char *data, float scale, size_t n, float *values);
+};
+
+} // namespace grpropa
+
+#endif // GRPROPA_COMPRESSEDGRID_H
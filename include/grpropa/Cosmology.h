@@ -61,6 +61,13 @@ double lightTravelDistance2Redshift(double distance);
  */
 double redshift2LightTravelDistance(double redshift);
 
+/**
+ Redshift reached by a particle that travels the comoving distance d towards z = 0, starting at redshift z.
+ Short distances use a second order expansion of z(d) with dz/dd = -H(z) / c, long ones the tabulated comoving distance.
+ Returns 0 if z = 0 is reached.
+ */
+double redshiftAfterComovingDistance(double z, double d);
+
 // Conversion from comoving distance to light travel distance.
 double comoving2LightTravelDistance(double distance);
 
@@ -4,6 +4,7 @@
 #include "grpropa/Referenced.h"
 #include "grpropa/Vector3.h"
 #include <vector>
+#include <stdexcept>
 
 namespace grpropa {
 
@@ -21,6 +22,15 @@ inline void reflectiveClamp(double x, int n, int &lo, int &hi) {
     hi = lo + (lo < n-1);
 }
 
+/** Index of grid point i in a reflectively repeated grid of n points, the period is 2 (n - 1) */
+inline int reflectiveIndex(int i, int n) {
+    if (n == 1)
+        return 0;
+    int period = 2 * (n - 1);
+    i = ((i % period) + period) % period;
+    return (i < n) ? i : period - i;
+}
+
 /** Symmetrical round */
 inline double round(double r) {
     return (r > 0.0) ? floor(r + 0.5) : ceil(r - 0.5);
@@ -33,24 +43,43 @@ inline double round(double r) {
  The grid spacing is constant and equal along all three axes.
  Values are calculated by trilinear interpolation of the surrounding 8 grid points.
  The grid is periodically (default) or reflectively extended.
- The grid sample positions are at 1/2 * size/N, 3/2 * size/N ... (2N-1)/2 * size/N.
+ The grid sample positions are at 1/2 * size/N, 3/2 * size/N ... (2N-1)/2 * size/N.\n
+ By default the values are stored with the z-index changing the fastest.
+ Alternatively they can be stored in bricks of B^3 grid points (see setBrickSize), so that the 8 neighbors of
+ an interpolation mostly lie in the same few cache lines. All accessors by index work with either layout.\n
+ The values can also live in external memory, e.g. a read-only memory mapped grid file (see mapVectorGrid). The
+ mutable accessors get and getGrid then copy the values into memory before returning a reference.
  */
 template<typename T>
 class Grid: public Referenced {
     std::vector<T> grid;
+    T *values; /**< Grid values, either in the vector or in external storage */
+    ref_ptr<Referenced> storage; /**< Owner of the external storage, null if the values are in the vector */
     size_t Nx, Ny, Nz; /**< Number of grid points */
+    size_t brickBits; /**< log2 of the brick size, 0 for the linear layout */
+    size_t NBy, NBz; /**< Number of bricks in y- and z-direction */
     Vector3d origin; /**< Origin of the volume that is represented by the grid. */
     Vector3d gridOrigin; /**< Grid origin */
     double spacing; /**< Distance between grid points, determines the extension of the grid */
     bool reflective; /**< If set to true, the grid is repeated reflectively instead of periodically */
 
+    void setDimensions(size_t Nx, size_t Ny, size_t Nz) {
+        this->Nx = Nx;
+        this->Ny = Ny;
+        this->Nz = Nz;
+        size_t B = size_t(1) << brickBits;
+        NBy = (Ny + B - 1) >> brickBits;
+        NBz = (Nz + B - 1) >> brickBits;
+        setOrigin(origin);
+    }
+
 public:
     /** Constructor for cubic grid
      @param origin  Position of the lower left front corner of the volume
      @param N       Number of grid points in one direction
      @param spacing Spacing between grid points
      */
-    Grid(Vector3d origin, size_t N, double spacing) {
+    Grid(Vector3d origin, size_t N, double spacing) : brickBits(0) {
         setOrigin(origin);
         setGridSize(N, N, N);
         setSpacing(spacing);
@@ -64,13 +93,34 @@ public:
      @param Nz      Number of grid points in z-direction
      @param spacing Spacing between grid points
      */
-    Grid(Vector3d origin, size_t Nx, size_t Ny, size_t Nz, double spacing) {
+    Grid(Vector3d origin, size_t Nx, size_t Ny, size_t Nz, double spacing) : brickBits(0) {
         setOrigin(origin);
         setGridSize(Nx, Ny, Nz);
         setSpacing(spacing);
         setReflective(false);
     }
 
+    Grid(const Grid<T> &g) : Referenced(g) {
+        *this = g;
+    }
+
+    Grid<T> &operator=(const Grid<T> &g) {
+        grid = g.grid;
+        storage = g.storage;
+        values = storage ? g.values : (grid.empty() ? NULL : &grid[0]);
+        Nx = g.Nx;
+        Ny = g.Ny;
+        Nz = g.Nz;
+        brickBits = g.brickBits;
+        NBy = g.NBy;
+        NBz = g.NBz;
+        origin = g.origin;
+        gridOrigin = g.gridOrigin;
+        spacing = g.spacing;
+        reflective = g.reflective;
+        return *this;
+    }
+
     void setOrigin(Vector3d origin) {
         this->origin = origin;
         this->gridOrigin = origin + Vector3d(spacing/2);
@@ -78,11 +128,74 @@ public:
 
     /** Resize grid, also enlarges the volume as the spacing stays constant */
     void setGridSize(size_t Nx, size_t Ny, size_t Nz) {
-        this->Nx = Nx;
-        this->Ny = Ny;
-        this->Nz = Nz;
-        grid.resize(Nx * Ny * Nz);
-        setOrigin(origin);
+        setDimensions(Nx, Ny, Nz);
+        grid.resize(getStorageSize());
+        values = grid.empty() ? NULL : &grid[0];
+        storage = NULL;
+    }
+
+    /** Number of values in the current layout, including the padding of the bricks */
+    size_t getStorageSize() const {
+        size_t B = size_t(1) << brickBits;
+        return ((Nx + B - 1) >> brickBits) * NBy * NBz * B * B * B;
+    }
+
+    /**
+     Resize the grid and use external memory for the values, which have to be stored in the current layout
+     (see getStorageSize). The owner of the memory is kept alive as long as the grid uses it.
+     */
+    void setStorage(size_t Nx, size_t Ny, size_t Nz, T *values, ref_ptr<Referenced> owner) {
+        setDimensions(Nx, Ny, Nz);
+        std::vector<T>().swap(grid);
+        this->values = values;
+        storage = owner;
+    }
+
+    /** Values in the current layout (see getStorageSize), without copying values in external memory */
+    const T *getStorage() const {
+        return values;
+    }
+
+    /** Whether the values are in external memory */
+    bool hasExternalStorage() const {
+        return storage.valid();
+    }
+
+    /**
+     Store the values in bricks of size^3 grid points, size = 1 for the linear layout.
+     The size must be a power of 2 and the values are kept. If the grid size is not a multiple of the brick size,
+     the last bricks are padded.
+     */
+    void setBrickSize(size_t size) {
+        size_t bits = 0;
+        while ((size_t(1) << bits) < size)
+            bits++;
+        if ((size_t(1) << bits) != size)
+            throw std::runtime_error("Grid: brick size must be a power of 2");
+        if (bits == brickBits)
+            return;
+        Grid<T> old(*this);
+        brickBits = bits;
+        grid.clear();
+        setGridSize(Nx, Ny, Nz);
+        for (size_t ix = 0; ix < Nx; ix++)
+            for (size_t iy = 0; iy < Ny; iy++)
+                for (size_t iz = 0; iz < Nz; iz++)
+                    get(ix, iy, iz) = old.get(ix, iy, iz);
+    }
+
+    size_t getBrickSize() const {
+        return size_t(1) << brickBits;
+    }
+
+    /** Position of the value of grid point (ix, iy, iz) in the storage vector */
+    size_t index(size_t ix, size_t iy, size_t iz) const {
+        if (brickBits == 0)
+            return ix * Ny * Nz + iy * Nz + iz;
+        size_t mask = (size_t(1) << brickBits) - 1;
+        size_t brick = ((ix >> brickBits) * NBy + (iy >> brickBits)) * NBz + (iz >> brickBits);
+        size_t inner = (((ix & mask) << brickBits) + (iy & mask)) << brickBits | (iz & mask);
+        return (brick << (3 * brickBits)) + inner;
     }
 
     void setSpacing(double spacing) {
@@ -117,30 +230,47 @@ public:
         return reflective;
     }
 
-    /** Accessor / Mutator */
+    /** Accessor / Mutator, values in external memory are copied into memory first (see getGrid) */
     T &get(size_t ix, size_t iy, size_t iz) {
-        return grid[ix * Ny * Nz + iy * Nz + iz];
+        if (storage)
+            getGrid();
+        return values[index(ix, iy, iz)];
     }
 
     /** Accessor */
     const T &get(size_t ix, size_t iy, size_t iz) const {
-        return grid[ix * Ny * Nz + iy * Nz + iz];
+        return values[index(ix, iy, iz)];
     }
 
-    T getValue(size_t ix, size_t iy, size_t iz) {
-        return grid[ix * Ny * Nz + iy * Nz + iz];
+    /** Accessor that never copies values in external memory */
+    T getValue(size_t ix, size_t iy, size_t iz) const {
+        return values[index(ix, iy, iz)];
     }
 
-    /** Return a reference to the grid values */
+    /** Return a reference to the grid values, stored in the current layout. Values in external memory are copied. */
     std::vector<T> &getGrid() {
+        if (storage) {
+            grid.assign(values, values + getStorageSize());
+            values = grid.empty() ? NULL : &grid[0];
+            storage = NULL;
+        }
         return grid;
     }
 
-    /** Position of the grid point of a given index */
+    /** Position of the grid point of a given index in the storage vector */
     Vector3d positionFromIndex(int index) const {
-        int ix = index / (Ny * Nz);
-        int iy = (index / Nz) % Ny;
-        int iz = index % Nz;
+        if (brickBits == 0) {
+            int ix = index / (Ny * Nz);
+            int iy = (index / Nz) % Ny;
+            int iz = index % Nz;
+            return Vector3d(ix, iy, iz) * spacing + gridOrigin;
+        }
+        size_t mask = (size_t(1) << brickBits) - 1;
+        size_t brick = size_t(index) >> (3 * brickBits);
+        size_t inner = size_t(index) & ((size_t(1) << (3 * brickBits)) - 1);
+        size_t ix = ((brick / (NBy * NBz)) << brickBits) + (inner >> (2 * brickBits));
+        size_t iy = (((brick / NBz) % NBy) << brickBits) + ((inner >> brickBits) & mask);
+        size_t iz = ((brick % NBz) << brickBits) + (inner & mask);
         return Vector3d(ix, iy, iz) * spacing + gridOrigin;
     }
 
@@ -151,16 +281,14 @@ public:
         int iy = round(r.y);
         int iz = round(r.z);
         if (reflective) {
-            while ((ix < 0) or (ix > Nx))
-                ix = 2 * Nx * (ix > Nx) - ix;
-            while ((iy < 0) or (iy > Ny))
-                iy = 2 * Ny * (iy > Ny) - iy;
-            while ((iz < 0) or (iz > Nz))
-                iz = 2 * Nz * (iz > Nz) - iz;
+            ix = reflectiveIndex(ix, Nx);
+            iy = reflectiveIndex(iy, Ny);
+            iz = reflectiveIndex(iz, Nz);
         } else {
-            ix = ((ix % Nx) + Nx) % Nx;
-            iy = ((iy % Ny) + Ny) % Ny;
-            iz = ((iz % Nz) + Nz) % Nz;
+            int nx = Nx, ny = Ny, nz = Nz;
+            ix = ((ix % nx) + nx) % nx;
+            iy = ((iy % ny) + ny) % ny;
+            iz = ((iz % nz) + nz) % nz;
         }
         return get(ix, iy, iz);
     }
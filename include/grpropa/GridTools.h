@@ -3,6 +3,8 @@
 
 #include "grpropa/Common.h"
 #include "grpropa/Grid.h"
+#include "grpropa/CompressedGrid.h"
+#include "grpropa/magneticField/MagneticField.h"
 #include <string>
 
 namespace grpropa {
@@ -22,17 +24,36 @@ double rmsFieldStrength(ref_ptr<VectorGrid> grid);
 void scaleGrid(ref_ptr<ScalarGrid> grid, double a);
 void scaleGrid(ref_ptr<VectorGrid> grid, double a);
 
+/**
+ Sample a magnetic field at all grid points, in parallel, so that the grid can replace the field, e.g. in a
+ MagneticFieldGrid. The field has to be safe to evaluate from several threads.
+ The interpolated grid is then compared to the field at random positions between the outermost grid points.
+ @param nValidation	Number of validation positions
+ @param seed		Random seed of the validation positions, 0 for random positions
+ @return Relative RMS deviation sqrt(sum |B_grid - B|^2 / sum |B|^2) at the validation positions
+ */
+double bakeMagneticField(ref_ptr<VectorGrid> grid, ref_ptr<MagneticField> field, size_t nValidation = 1000, int seed = 0);
+
 #ifdef GRPROPA_HAVE_FFTW3F
 /**
  Create a random initialization of a turbulent field.
+ The grid does not need to be cubic. The k-space is filled in parallel, with a random number stream per x-slab
+ that is derived from the seed, so a seed gives the same field for any number of threads.
+ The components are transformed one after another, which needs one complex array of about half the grid size.
  @param lMin	Minimum wavelength of the turbulence
  @param lMax	Maximum wavelength of the turbulence
  @param alpha	Power law index of <B^2(k)> ~ k^alpha (alpha = -11/3 corresponds to a Kolmogorov spectrum)
  @param Brms	RMS field strength
- @param seed	Random seed
+ @param seed	Random seed, 0 for a random realisation
  @param H  		Amount of helicity; H is in [-1;1] where H=1 or -1 correspond to maximum helicity and fH = 0 is the non-helical case
  */
 void initTurbulence(ref_ptr<VectorGrid> grid, double Brms, double lMin, double lMax, double alpha = -11./3., int seed = 0, bool helicity = false, double H = 0);
+
+/**
+ File to load and save FFTW wisdom for initTurbulence, empty for none (default).
+ With a wisdom file the Fourier transforms are planned by measurement once and reused in later runs.
+ */
+void setTurbulenceWisdomFile(std::string filename);
 #endif // GRPROPA_HAVE_FFTW3F
 
 /** Analytically calculate the correlation length of a turbulent field */
@@ -42,6 +63,7 @@ double turbulentCorrelationLength(double lMin, double lMax, double alpha = -11./
  Dump / load functions for scalar / 3-vector grids and binary / plain text files.
  The grid points are stored from (0, 0, 0) to (Nx, Ny, Nz) with the z-index changing the fastest.
  Vector components are stored per grid point in xyz-order.
+ The file layout does not depend on the brick size of the grid (see Grid::setBrickSize).
 
  In case of plain-text files the vector components are separated by a blank or tab and grid points are stored one per line.
  Also there can be any number of comment lines at the beginning of the file, started with a #.
@@ -54,12 +76,40 @@ void loadGrid(ref_ptr<VectorGrid> grid, std::string filename, double conversion
 // Load a ScalarGrid from a binary file with single precision.
 void loadGrid(ref_ptr<ScalarGrid> grid, std::string filename, double conversion = 1);
 
+// Load a CompressedVectorGrid from a binary file with single precision, without holding the full grid in memory.
+void loadGrid(ref_ptr<CompressedVectorGrid> grid, std::string filename, double conversion = 1);
+
 // Dump a VectorGrid to a binary file.
 void dumpGrid(ref_ptr<VectorGrid> grid, std::string filename, double conversion = 1);
 
 // Dump a ScalarGrid to a binary file with single precision.
 void dumpGrid(ref_ptr<ScalarGrid> grid, std::string filename, double conversion = 1);
 
+// Dump the decoded values of a CompressedVectorGrid to a binary file with single precision.
+void dumpGrid(ref_ptr<CompressedVectorGrid> grid, std::string filename, double conversion = 1);
+
+/**
+ Self-describing grid files, which can be memory mapped.
+ The header records the element type, grid size, spacing, origin, extension and brick size of the grid.
+ The values follow at an offset that is a multiple of the page size, in the storage layout of the grid.
+ */
+// Save a VectorGrid with its header.
+void saveGrid(ref_ptr<VectorGrid> grid, std::string filename);
+
+// Save a ScalarGrid with its header.
+void saveGrid(ref_ptr<ScalarGrid> grid, std::string filename);
+
+/**
+ Map a grid file written by saveGrid into memory and wrap it in a VectorGrid without copying.
+ The pages are shared with all other processes that map the same file. The mapping is read-only: the first call of
+ the mutable Grid::get or Grid::getGrid copies the values into memory, so that modifying the grid never writes to
+ the file. Reading with interpolate, closestValue or getValue uses the mapping directly.
+ */
+ref_ptr<VectorGrid> mapVectorGrid(std::string filename);
+
+// Map a grid file written by saveGrid into memory and wrap it in a ScalarGrid, see mapVectorGrid.
+ref_ptr<ScalarGrid> mapScalarGrid(std::string filename);
+
 // Load a VectorGrid grid from a plain text file.
 void loadGridFromTxt(ref_ptr<VectorGrid> grid, std::string filename, double conversion = 1);
 
@@ -59,6 +59,13 @@ public:
     void setMakeAcceptedInactive(bool makeInactive);
     void setRejectFlag(std::string key, std::string value);
     void setAcceptFlag(std::string key, std::string value);
+
+    /**
+     Distance along a straight line from position in direction until the condition rejects a particle,
+     std::numeric_limits<double>::infinity() if it never does, or -1 if the condition cannot tell (the default).
+     Used to move neutral particles in one step, see NeutralFastPath.
+     */
+    virtual double distanceToRejection(const Vector3d &position, const Vector3d &direction) const;
 };
 } // namespace grpropa
 
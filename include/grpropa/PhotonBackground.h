@@ -1,6 +1,12 @@
 #ifndef GRPROPA_PHOTONBACKGROUND_H
 #define GRPROPA_PHOTONBACKGROUND_H
 
+#include "grpropa/Referenced.h"
+#include "grpropa/Units.h"
+
+#include <string>
+#include <vector>
+
 namespace grpropa {
 
 // Photon fields
@@ -14,6 +20,130 @@ enum PhotonField {
 // Returns list of available photon background models
 void listOfPhotonBackgroundModels();
 
+/**
+ @class CustomPhotonField
+ @brief Photon field given by a tabulated differential number density dn/deps(eps, z).
+
+ The density is interpolated log-log in the photon energy and linearly in redshift.
+ Outside of the tabulated photon energies the density is 0, outside of the tabulated redshifts it is clamped.
+ A field given at a single redshift is assumed to evolve like the CMB, i.e. the interaction modules
+ scale the tables with (1 + z) as they do for the built-in CMB and CRB models.
+ */
+class CustomPhotonField: public Referenced {
+private:
+    std::vector<double> tabPhotonEnergy; /* photon energy [J] */
+    std::vector<double> tabRedshift; /* redshifts of the tabulated densities */
+    std::vector<double> tabDensity; /* dn/deps [1/m^3/J], tabDensity[iz * tabPhotonEnergy.size() + ie] */
+
+public:
+    CustomPhotonField();
+
+    /**
+     @param photonEnergies  photon energies [J] in ascending order
+     @param redshifts       redshifts in ascending order
+     @param density         dn/deps [1/m^3/J] with the photon energy changing the fastest
+     */
+    CustomPhotonField(const std::vector<double> &photonEnergies, const std::vector<double> &redshifts, const std::vector<double> &density);
+
+    void setDensity(const std::vector<double> &photonEnergies, const std::vector<double> &redshifts, const std::vector<double> &density);
+
+    /**
+     Load the density from a plain text file.
+     Lines starting with # are comments. The first data line lists the redshifts,
+     every following line holds a photon energy [eV] and dn/deps [1/cm^3/eV] at each of the redshifts.
+     */
+    void loadFromTxt(std::string filename);
+
+    /** Differential number density dn/deps [1/m^3/J] at photon energy eps [J] and redshift z */
+    double getPhotonDensity(double eps, double z) const;
+
+    const std::vector<double> &getPhotonEnergies() const;
+    const std::vector<double> &getRedshifts() const;
+};
+
+/**
+ @class InteractionTables
+ @brief Interaction rate and background photon tables in the layout of the interaction modules.
+
+ tabRate holds the interaction rate [1/m] with the particle energy changing the fastest,
+ tabPhotonEnergy the background photon energy [J] for each cumulative probability in tabProb,
+ with the probability changing the fastest. There is one column per redshift in tabRedshift.
+ */
+class InteractionTables: public Referenced {
+public:
+    std::vector<double> tabEnergy; /* particle energy [J] */
+    std::vector<double> tabRedshift; /* redshifts */
+    std::vector<double> tabRate; /* interaction rate [1/m] */
+    std::vector<double> tabProb; /* cumulative probability of the background photon energy */
+    std::vector<double> tabPhotonEnergy; /* background photon energy [J] */
+
+    /**
+     Write the tables in the format of the rate and photon probability files in the data directory,
+     i.e. energies in [eV] and rates in [1/Mpc], one column per redshift.
+     */
+    void dump(std::string rateFilename, std::string probabilityFilename) const;
+};
+
+/**
+ @class TabulatedInteraction
+ @brief Interaction rate and background photon tables as they are used by PairProduction and InverseCompton.
+
+ The tables are read from the data files or installed from InteractionTables, and then resampled to the requested
+ resolution and optionally stored in single precision (see PairProduction::setTableResolution).
+ */
+class TabulatedInteraction {
+public:
+    std::vector<double> tabEnergy; /* tabulated energy [J] */
+    std::vector<double> tabRate; /* tabulated rate [1/m] */
+    std::vector<double> tabRedshift; /* tabulated redshifts for z dependence of the IRB */
+    std::vector<double> tabPhotonEnergy; /* background photon energy*/
+    std::vector<double> tabProb; /* cumulative probability for background photon. */
+    std::vector<float> tabEnergyF, tabRateF, tabRedshiftF, tabPhotonEnergyF, tabProbF; /* single precision tables, used instead of the above if singlePrecision is set */
+    bool redshiftDependence; /* whether the photon field is redshift-dependent */
+
+    size_t nTableEnergies; /* number of energies of the resampled rate table, 0 to keep the tabulated energies */
+    size_t nTableProbabilities; /* number of probabilities of the resampled background photon table, 0 to keep them */
+    bool singlePrecision; /* whether the tables are stored as float */
+    double rateTableError; /* maximum relative error of the rate table introduced by resampling and rounding */
+    double photonTableError; /* maximum relative error of the background photon table introduced by resampling and rounding */
+    double tableEnergyMin, tableEnergyMax, tableRateLast; /* table limits and the rate used for extrapolation */
+    ref_ptr<InteractionTables> customTables; /* tables set with setInteractionTables, if any */
+
+    TabulatedInteraction();
+
+    /**
+     Copy the tables after checking that they are consistent, the resolution is applied by applyTableResolution.
+     @param tables   interaction tables, kept for a later change of the resolution
+     @param module   name of the module used in the error messages
+     */
+    void setInteractionTables(ref_ptr<InteractionTables> tables, const std::string &module);
+
+    /** Resample the double precision tables to the resolution and convert them to float if singlePrecision is set */
+    void applyTableResolution();
+
+    /** Interaction rate [1/m] at energy E [J] and redshift z */
+    double rate(double E, double z) const;
+
+    /** Background photon energy [J] at cumulative probability p and redshift z */
+    double photonEnergy(double p, double z) const;
+};
+
+/**
+ Compute the pair production rates of photons and the background photon tables from a photon field.
+ The integration over the photon field is parallelized with OpenMP.
+ @param field       photon field
+ @param nEnergies   number of photon energies, logarithmically spaced between Emin and Emax
+ @param Emin        minimum photon energy [J]
+ @param Emax        maximum photon energy [J]
+ @param nProb       number of points of the cumulative background photon distribution
+ */
+ref_ptr<InteractionTables> pairProductionTables(ref_ptr<CustomPhotonField> field, size_t nEnergies = 701, double Emin = 1e6 * eV, double Emax = 1e20 * eV, size_t nProb = 500);
+
+/**
+ Compute the inverse Compton rates of electrons and the background photon tables from a photon field.
+ The parameters are the same as for pairProductionTables, with the energies referring to the electron.
+ */
+ref_ptr<InteractionTables> inverseComptonTables(ref_ptr<CustomPhotonField> field, size_t nEnergies = 701, double Emin = 1e6 * eV, double Emax = 1e20 * eV, size_t nProb = 500);
 
 } // namespace grpropa
 
@@ -0,0 +1,114 @@
+#ifndef GRPROPA_TILEDGRID_H
+#define GRPROPA_TILEDGRID_H
+
+#include "grpropa/CompressedGrid.h"
+
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+namespace grpropa {
+
+/**
+ @class TiledVectorGrid
+ @brief Vector grid that is read on demand from compressed tiles in a file
+
+ For fields that do not fit into memory. The file holds tiles of T^3 grid points, each encoded like a brick of a
+ CompressedVectorGrid. Tiles are decoded when they are first accessed and kept in a cache of fixed size,
+ from which the least recently used tile is evicted (recency is counted in cache misses).\n
+ The cache is shared by all threads. Reading a cached tile takes no lock: each cache slot carries a version number
+ that is odd while the slot is refilled, and a read is repeated if the version changed meanwhile.
+ Loading a missing tile is serialized per grid. Cache hits are counted in per-thread counters.\n
+ Geometry, trilinear interpolation and the periodic or reflective extension are the same as for a VectorGrid.
+ */
+class TiledVectorGrid: public Referenced {
+    struct Slot {
+        size_t tile; /**< Index of the cached tile */
+        unsigned long version; /**< Odd while the slot is being refilled */
+        unsigned long lastUse; /**< Number of misses at the last access */
+        std::vector<Vector3f> values;
+    };
+
+    /** Hit counter of one thread, padded so that the counters of two threads never share a cache line */
+    struct Counter {
+        unsigned long count;
+        char padding[128 - sizeof(unsigned long)];
+    };
+
+    std::string filename;
+    int fd; /**< File descriptor of the tile file */
+    CompressedVectorGrid::Encoding encoding;
+    size_t Nx, Ny, Nz; /**< Number of grid points */
+    size_t tileBits; /**< log2 of the tile size */
+    size_t NTx, NTy, NTz; /**< Number of tiles */
+    size_t tileBytes; /**< Encoded size of a tile */
+    unsigned long long dataOffset; /**< Position of the first tile in the file */
+    std::vector<float> scales; /**< Scale factor per tile */
+    Vector3d origin; /**< Origin of the volume that is represented by the grid. */
+    Vector3d gridOrigin; /**< Grid origin */
+    double spacing; /**< Distance between grid points */
+    bool reflective; /**< If set to true, the grid is repeated reflectively instead of periodically */
+
+    mutable std::vector<Slot> slots; /**< Tile cache */
+    mutable std::vector<long> slotOfTile; /**< Cache slot of each tile, -1 if not cached */
+    mutable std::vector<Counter> hits; /**< Cache hits, counted per thread */
+    mutable unsigned long misses;
+    mutable pthread_mutex_t loadMutex; /**< Serializes loading of tiles */
+
+    void loadTile(size_t tile) const;
+
+    // owns a file descriptor and a mutex, not copyable
+    TiledVectorGrid(const TiledVectorGrid &);
+    TiledVectorGrid &operator=(const TiledVectorGrid &);
+
+public:
+    /**
+     Open a tile file written by TiledVectorGrid::create or TiledVectorGrid::convert.
+     @param filename  Tile file
+     @param cacheSize Maximum number of tiles in memory
+     */
+    TiledVectorGrid(std::string filename, size_t cacheSize = 1024);
+    ~TiledVectorGrid();
+
+    /** Write a VectorGrid as tile file */
+    static void create(std::string filename, ref_ptr<VectorGrid> grid,
+            CompressedVectorGrid::Encoding encoding = CompressedVectorGrid::Int16, size_t tileSize = 16);
+
+    /**
+     Convert a binary file with single precision as read by loadGrid to a tile file.
+     Only tileSize planes of the grid are held in memory at a time.
+     */
+    static void convert(std::string gridFile, std::string filename, Vector3d origin, size_t Nx, size_t Ny,
+            size_t Nz, double spacing, CompressedVectorGrid::Encoding encoding = CompressedVectorGrid::Int16,
+            size_t tileSize = 16, double conversion = 1);
+
+    /** Decoded value of a grid point */
+    Vector3f get(size_t ix, size_t iy, size_t iz) const;
+
+    /** Decoded value of the grid point that is closest to a given position */
+    Vector3f closestValue(const Vector3d &position) const;
+
+    /** Interpolate the decoded grid at a given position */
+    Vector3f interpolate(const Vector3d &position) const;
+
+    void setReflective(bool b);
+    bool isReflective() const;
+    Vector3d getOrigin() const;
+    size_t getNx() const;
+    size_t getNy() const;
+    size_t getNz() const;
+    double getSpacing() const;
+    size_t getTileSize() const;
+    size_t getCacheSize() const;
+
+    /** Number of tile accesses that were served from the cache */
+    unsigned long getCacheHits() const;
+    /** Number of tile accesses that loaded the tile from the file */
+    unsigned long getCacheMisses() const;
+    void resetStatistics();
+};
+
+} // namespace grpropa
+
+#endif // GRPROPA_TILEDGRID_H
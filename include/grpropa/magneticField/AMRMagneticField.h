@@ -27,6 +27,9 @@ namespace grpropa {
 /**
  @class AMRMagneticField
  @brief Wrapper for saga::MagneticField
+
+ Calls to SAGA are serialized between threads. For parallel simulations sample the field once into an
+ OctreeMagneticField, which is evaluated without locking.
  */
 class AMRMagneticField: public MagneticField {
 
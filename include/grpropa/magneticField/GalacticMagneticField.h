@@ -1,5 +1,5 @@
 #ifndef GRPROPA_GALACTICMAGNETICFIELD_H
-#define GPROPA_GALACTICMAGNETICFIELD_H
+#define GRPROPA_GALACTICMAGNETICFIELD_H
 
 #include "grpropa/magneticField/MagneticField.h"
 #include <cmath>
@@ -24,9 +24,9 @@ public:
         this->r0 = r0;
     }
 
-    Vector3d getField(Vector3d pos) {
+    Vector3d getField(const Vector3d &pos) const {
         double r = sqrt(pos.x * pos.x + pos.y * pos.y) / r0; // in-plane radius in units of the radial scale
-        double b = b0 / (1 + pow((abs(pos.z) - z0) / z1, 2)) * r * exp(1 - r);
+        double b = b0 / (1 + pow((fabs(pos.z) - z0) / z1, 2)) * r * exp(1 - r);
         double phi = pos.getPhi(); // azimuth
         return Vector3d(cos(phi), sin(phi), 0) * b;
     }
@@ -77,7 +77,7 @@ public:
         updatePhase();
     }
 
-    Vector3d getField(Vector3d pos) const {
+    Vector3d getField(const Vector3d &pos) const {
         double r = sqrt(pos.x * pos.x + pos.y * pos.y); // in-plane radius
         double b = b0 / cosPhase * rsol / std::max(r, rc);
 
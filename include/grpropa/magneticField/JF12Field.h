@@ -114,6 +114,10 @@ public:
 
     // All set field components
     Vector3d getField(const Vector3d& pos) const;
+
+    // All set field components at n positions
+    void getFields(const double *x, const double *y, const double *z, double *bx, double *by, double *bz,
+            size_t n) const;
 };
 
 } // namespace crpropa
@@ -15,6 +15,14 @@ public:
     virtual ~MagneticField() {
     }
     virtual Vector3d getField(const Vector3d &position) const = 0;
+
+    /**
+     Calculates the magnetic field (bx, by, bz) at n positions (x, y, z).
+     The default implementation calls getField for each position, fields that can share work between positions
+     override it.
+     */
+    virtual void getFields(const double *x, const double *y, const double *z, double *bx, double *by, double *bz,
+            size_t n) const;
 };
 
 /**
@@ -35,6 +43,8 @@ public:
     bool isReflective();
     void setReflective(bool reflective);
     Vector3d getField(const Vector3d &position) const;
+    void getFields(const double *x, const double *y, const double *z, double *bx, double *by, double *bz,
+            size_t n) const;
 };
 
 /**
@@ -46,6 +56,8 @@ class MagneticFieldList: public MagneticField {
 public:
     void addField(ref_ptr<MagneticField> field);
     Vector3d getField(const Vector3d &position) const;
+    void getFields(const double *x, const double *y, const double *z, double *bx, double *by, double *bz,
+            size_t n) const;
 };
 
 /**
@@ -61,6 +73,14 @@ public:
     Vector3d getField(const Vector3d &position) const {
         return value;
     }
+    void getFields(const double *x, const double *y, const double *z, double *bx, double *by, double *bz,
+            size_t n) const {
+        for (size_t i = 0; i < n; i++) {
+            bx[i] = value.x;
+            by[i] = value.y;
+            bz[i] = value.z;
+        }
+    }
 };
 
 } // namespace grpropa
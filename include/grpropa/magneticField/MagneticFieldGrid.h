@@ -3,6 +3,8 @@
 
 #include "grpropa/magneticField/MagneticField.h"
 #include "grpropa/Grid.h"
+#include "grpropa/CompressedGrid.h"
+#include "grpropa/TiledGrid.h"
 
 namespace grpropa {
 
@@ -10,35 +12,57 @@ namespace grpropa {
  @class MagneticFieldGrid
  @brief Magnetic field on a periodic (or reflective), cartesian grid with trilinear interpolation.
 
- This class wraps a VectorGrid to serve as a MagneticField.
+ This class wraps a VectorGrid, a CompressedVectorGrid or a TiledVectorGrid to serve as a MagneticField.
+ Optionally the value of the closest grid point is returned instead of the interpolation, which makes the field constant
+ within each grid cell (see PropagationHelix).
  */
 class MagneticFieldGrid: public MagneticField {
     ref_ptr<VectorGrid> grid;
+    ref_ptr<CompressedVectorGrid> compressedGrid;
+    ref_ptr<TiledVectorGrid> tiledGrid;
+    bool nearestCell;
 public:
     MagneticFieldGrid(ref_ptr<VectorGrid> grid);
+    MagneticFieldGrid(ref_ptr<CompressedVectorGrid> grid);
+    MagneticFieldGrid(ref_ptr<TiledVectorGrid> grid);
     void setGrid(ref_ptr<VectorGrid> grid);
+    void setGrid(ref_ptr<CompressedVectorGrid> grid);
+    void setGrid(ref_ptr<TiledVectorGrid> grid);
+    /** The wrapped VectorGrid, null if a CompressedVectorGrid or TiledVectorGrid is used */
     ref_ptr<VectorGrid> getGrid();
+    ref_ptr<CompressedVectorGrid> getCompressedGrid();
+    ref_ptr<TiledVectorGrid> getTiledGrid();
+    /** Use the value of the closest grid point instead of trilinear interpolation */
+    void setNearestCell(bool nearestCell);
+    bool isNearestCell() const;
     Vector3d getField(const Vector3d &position) const;
+    void getFields(const double *x, const double *y, const double *z, double *bx, double *by, double *bz,
+            size_t n) const;
 };
 
 /**
  @class MagneticFieldGrid
  @brief Modulated magnetic field on a periodic grid.
 
- This class wraps a VectorGrid to serve as a MagneticField.
+ This class wraps a VectorGrid or a CompressedVectorGrid to serve as a MagneticField.
  The field is modulated on-the-fly with a ScalarGrid.
  The VectorGrid and ScalarGrid do not need to share the same origin, spacing or size.
  */
 class ModulatedMagneticFieldGrid: public MagneticField {
     ref_ptr<VectorGrid> grid;
+    ref_ptr<CompressedVectorGrid> compressedGrid;
     ref_ptr<ScalarGrid> modGrid;
 public:
     ModulatedMagneticFieldGrid() {
     }
     ModulatedMagneticFieldGrid(ref_ptr<VectorGrid> grid, ref_ptr<ScalarGrid> modGrid);
+    ModulatedMagneticFieldGrid(ref_ptr<CompressedVectorGrid> grid, ref_ptr<ScalarGrid> modGrid);
     void setGrid(ref_ptr<VectorGrid> grid);
+    void setGrid(ref_ptr<CompressedVectorGrid> grid);
     void setModulationGrid(ref_ptr<ScalarGrid> modGrid);
+    /** The wrapped VectorGrid, null if a CompressedVectorGrid is used */
     ref_ptr<VectorGrid> getGrid();
+    ref_ptr<CompressedVectorGrid> getCompressedGrid();
     ref_ptr<ScalarGrid> getModulationGrid();
     void setReflective(bool gridReflective, bool modGridReflective);
     Vector3d getField(const Vector3d &position) const;
@@ -0,0 +1,72 @@
+#ifndef GRPROPA_OCTREEMAGNETICFIELD_H
+#define GRPROPA_OCTREEMAGNETICFIELD_H
+
+#include "grpropa/magneticField/MagneticField.h"
+
+#include <string>
+#include <vector>
+
+namespace grpropa {
+
+/**
+ @class OctreeMagneticField
+ @brief Adaptively refined magnetic field on an octree, e.g. imported from an AMR simulation
+
+ The field is sampled once from another MagneticField, for instance an AMRMagneticField wrapping SAGA, or read
+ from a file written with save. A cube is refined into 8 children as long as the field at the corners of the
+ children deviates from the interpolation of its corners by more than a given tolerance, up to a maximum level.\n
+ The tree is stored in a flat array: each node holds the index of its first child (the 8 children are consecutive)
+ and the indices of its 8 corner values, which are shared with neighboring cells. Queries only read the arrays, so
+ getField can be called from any number of threads without locking. Within a leaf the field is interpolated
+ trilinearly from the corners of that leaf, i.e. with the resolution of its level. Corners of fine cells that lie on
+ a face or edge of a coarser cell take the interpolated value of the coarser cell, so the field is continuous where
+ levels meet.
+ Outside of the cube the field is zero.
+ */
+class OctreeMagneticField: public MagneticField {
+public:
+    struct Node {
+        int child; /**< Index of the first child, -1 for leaves */
+        unsigned int corner[8]; /**< Indices of the corner values, x is the highest bit */
+    };
+
+private:
+    Vector3d origin; /**< Lower corner of the cube */
+    double size; /**< Edge length of the cube */
+    std::vector<Node> nodes; /**< Nodes in depth first order, nodes[0] is the root */
+    std::vector<Vector3f> values; /**< Field at the corners of the cells */
+    size_t depth; /**< Deepest level of the tree */
+
+public:
+    /**
+     Sample a magnetic field on an adaptive octree.
+     @param field     Field to sample; it is only evaluated during construction, from one thread
+     @param origin    Lower corner of the cube
+     @param size      Edge length of the cube
+     @param maxLevel  Maximum level of refinement, the smallest cells have size / 2^maxLevel
+     @param tolerance Maximum deviation of the field at the corners of the children from the interpolation of the corners
+     @param minLevel  Level to which the tree is refined unconditionally
+     */
+    OctreeMagneticField(ref_ptr<MagneticField> field, Vector3d origin, double size, size_t maxLevel,
+            double tolerance, size_t minLevel = 2);
+
+    /** Read an octree from a file written with save */
+    OctreeMagneticField(std::string filename);
+
+    /** Write the octree to a binary file */
+    void save(std::string filename) const;
+
+    Vector3d getOrigin() const;
+    double getSize() const;
+    size_t getNumberOfNodes() const;
+    size_t getNumberOfValues() const;
+    size_t getDepth() const;
+    /** Level of the leaf that contains the position, -1 outside of the cube */
+    int getLevel(const Vector3d &position) const;
+
+    Vector3d getField(const Vector3d &position) const;
+};
+
+} // namespace grpropa
+
+#endif // GRPROPA_OCTREEMAGNETICFIELD_H
@@ -0,0 +1,56 @@
+#ifndef GRPROPA_PROCEDURALTURBULENTFIELD_H
+#define GRPROPA_PROCEDURALTURBULENTFIELD_H
+
+#include "grpropa/magneticField/MagneticField.h"
+#include "grpropa/Grid.h"
+
+namespace grpropa {
+
+/**
+ @class ProceduralTurbulentField
+ @brief Turbulent magnetic field of unlimited extent, assembled from one small periodic tile
+
+ Space is divided into cubes of the size of the tile. Each cube shows the tile with one of the 24 rotations of the
+ cube and a random shift, both derived from a hash of the seed and the cube index. The cubes are blended smoothly
+ across their boundaries and the blend is normalized to keep the RMS field strength. No random state is stored:
+ the field at any position is evaluated in O(1) from 8 tile interpolations, and different seeds can share one tile.\n
+ The power spectrum of the tile is preserved on scales well below the tile size, while correlations beyond the tile
+ size are removed. The blending adds a small divergence of order B / tile size in the transition regions.
+ */
+class ProceduralTurbulentField: public MagneticField {
+    ref_ptr<VectorGrid> tile;
+    double tileSize; /**< Edge length of the tile */
+    unsigned long long seed;
+
+public:
+    /**
+     @param tile Periodic, cubic turbulence grid, e.g. from createTile or initTurbulence
+     @param seed Seed of the arrangement of the tiles; unlike in createTile, 0 is an ordinary seed and gives a fixed
+                 arrangement
+     */
+    ProceduralTurbulentField(ref_ptr<VectorGrid> tile, int seed = 0);
+
+    /**
+     Create a periodic turbulence tile from the Fourier modes that fit into the tile, normalized to Brms.
+     The modes are summed with one discrete Fourier transform per axis, O(N^4), without the need for FFTW.
+     @param N       Number of grid points in each direction
+     @param spacing Spacing between grid points
+     @param Brms    RMS field strength
+     @param lMin    Minimum wavelength of the turbulence, at least 2 * spacing
+     @param lMax    Maximum wavelength of the turbulence, at most N * spacing
+     @param alpha   Power law index of <B^2(k)> ~ k^alpha (alpha = -11/3 corresponds to a Kolmogorov spectrum)
+     @param seed    Random seed of the tile; 0 draws a different random tile on every call
+     */
+    static ref_ptr<VectorGrid> createTile(size_t N, double spacing, double Brms, double lMin, double lMax,
+            double alpha = -11. / 3., int seed = 0);
+
+    void setSeed(int seed);
+    int getSeed() const;
+    ref_ptr<VectorGrid> getTile();
+
+    Vector3d getField(const Vector3d &position) const;
+};
+
+} // namespace grpropa
+
+#endif // GRPROPA_PROCEDURALTURBULENTFIELD_H
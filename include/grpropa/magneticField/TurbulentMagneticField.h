@@ -15,8 +15,10 @@ namespace grpropa {
  This class represents random magnetic field with a turbulent spectrum.
  The field is calculated at any point with double precision from a number of random modes.
  For reference see Giacinti 2011, DOI: 10.1016/j.astropartphys.2011.07.006
- Note that the normalization of the turbulent modes is not yet correct.
- Note that this method is slow: O(0.1 ms) on a 2.1 GHz Centrino
+ The modes are stored as separate arrays per component and evaluated in blocks with a polynomial sine and cosine,
+ which the compiler can vectorize. With GCC on x86-64 Linux the evaluation is compiled for AVX-512, AVX2 and the
+ baseline, and the version for the CPU is selected at load time. Evaluating many positions at once with getFields
+ reuses each block of modes.
  */
 class TurbulentMagneticField: public MagneticField {
 public:
@@ -30,6 +32,9 @@ public:
     /** Calculates the magnetic field at position from the dialed random turbulent modes */
     Vector3d getField(const Vector3d &position) const;
 
+    /** Calculates the magnetic field (bx, by, bz) at n positions (x, y, z) */
+    void getFields(const double *x, const double *y, const double *z, double *bx, double *by, double *bz, size_t n) const;
+
     /**
      * Define the properties of the turbulence.
      * @param Brms      RMS field strength
@@ -55,14 +60,11 @@ public:
     double getCorrelationLength() const;
 
 private:
-    struct Mode {
-        double amplitude;
-        double phase;
-        Vector3d e1;
-        Vector3d e2;
-        Vector3d k;
-    };
-    std::vector<Mode> modes; /**< List of random turbulent modes */
+    // random turbulent modes, one array per component, the polarization vectors are multiplied by the amplitude
+    std::vector<double> kx, ky, kz; /**< Wave vectors */
+    std::vector<double> e1x, e1y, e1z; /**< Amplitude of the cos part */
+    std::vector<double> e2x, e2y, e2z; /**< Amplitude of the sin part */
+    std::vector<double> phase; /**< Phases */
     int nModes; /**< Number of modes */
     double spectralIndex; /**< Power spectral index of the turbulence */
     double Brms; /**< RMS Field strength */
@@ -52,7 +52,8 @@ public:
  @brief Flags a particle when exiting the cube.
  This module flags particles when outside of the cube, defined by a lower corner and edge length.
  The particle is made inactive and by default is flagged "OutOfBounds".
- Optionally the module can ensure the candidate does not overshoot the boundary by more than a set margin.
+ Particles made inactive are moved back to the point where they crossed the boundary during the last step.
+ Optionally the module can additionally ensure the candidate does not overshoot the boundary by more than a set margin.
  */
 class CubicBoundary: public AbstractCondition {
 private:
@@ -60,6 +61,8 @@ private:
     double size;
     double margin;
     bool limitStep;
+    /** Fraction of the current step at which the particle left the volume */
+    double crossingFraction(const Candidate *candidate) const;
 public:
     CubicBoundary();
     CubicBoundary(Vector3d origin, double size);
@@ -69,6 +72,7 @@ public:
     void setMargin(double margin);
     void setLimitStep(bool limitStep);
     std::string getDescription() const;
+    double distanceToRejection(const Vector3d &position, const Vector3d &direction) const;
 };
 
 /**
@@ -76,7 +80,8 @@ public:
  @brief Flag a particle when leaving the sphere.
  This module flags particles when outside of the sphere, defined by a center and radius.
  The particle is made inactive and by default is flagged "OutOfBounds".
- Optionally the module can ensure the candidate does not overshoot the boundary by more than a set margin.
+ Particles made inactive are moved back to the point where they crossed the boundary during the last step.
+ Optionally the module can additionally ensure the candidate does not overshoot the boundary by more than a set margin.
  */
 class SphericalBoundary: public AbstractCondition {
 private:
@@ -84,6 +89,8 @@ private:
     double radius;
     double margin;
     bool limitStep;
+    /** Fraction of the current step at which the particle left the volume */
+    double crossingFraction(const Candidate *candidate) const;
 
 public:
     SphericalBoundary();
@@ -94,6 +101,7 @@ public:
     void setMargin(double margin);
     void setLimitStep(bool limitStep);
     std::string getDescription() const;
+    double distanceToRejection(const Vector3d &position, const Vector3d &direction) const;
 };
 
 /**
@@ -101,7 +109,8 @@ public:
  @brief Flags a particle when leaving the ellipsoid.
  This module flags particles when outside of the ellipsoid, defined by two focal points and a major axis (length).
  The particle is made inactive and by default is flagged "OutOfBounds".
- Optionally the module can ensure the candidate does not overshoot the boundary by more than a set margin.
+ Particles made inactive are moved back to the point where they crossed the boundary during the last step.
+ Optionally the module can additionally ensure the candidate does not overshoot the boundary by more than a set margin.
  */
 class EllipsoidalBoundary: public AbstractCondition {
 private:
@@ -110,6 +119,8 @@ private:
     double majorAxis;
     double margin;
     bool limitStep;
+    /** Fraction of the current step at which the particle left the volume */
+    double crossingFraction(const Candidate *candidate) const;
 
 public:
     EllipsoidalBoundary();
@@ -121,6 +132,7 @@ public:
     void setMargin(double margin);
     void setLimitStep(bool limitStep);
     std::string getDescription() const;
+    double distanceToRejection(const Vector3d &position, const Vector3d &direction) const;
 };
 
 } // namespace crpropa
@@ -0,0 +1,61 @@
+#ifndef GRPROPA_CONTINUOUSENERGYLOSS_H
+#define GRPROPA_CONTINUOUSENERGYLOSS_H
+
+#include "grpropa/Module.h"
+#include "grpropa/magneticField/MagneticField.h"
+#include "grpropa/module/InverseCompton.h"
+
+namespace grpropa {
+
+/**
+ @class ContinuousEnergyLoss
+ @brief Combined continuous energy losses: adiabatic expansion, synchrotron and inverse Compton in the Thomson limit.
+
+ All continuous losses are combined into dE/dx = -a(z) E - b(z, B) E^2, where a = H(z) / (c (1 + z)) describes the
+ adiabatic loss and b the synchrotron and Thomson losses of electrons and positrons.
+ This Bernoulli equation is solved analytically over the step,
+ E = E0 r / (1 + E0 int b r dx) with r = (1 + z) / (1 + z0),
+ where the integral is evaluated with Simpson's rule at the start, middle and end of the step.
+ The result is exact for constant field and radiation density, so the step does not need to resolve the energy loss.\n
+ This module replaces Redshift and the energy loss of Synchrotron; like Redshift it updates the redshift and the cosmic time.
+ The magnetic field is assumed to scale as (1 + z)^2 and the radiation density as (1 + z)^4.
+ The Thomson loss is disabled by default, since the InverseCompton module treats the scattering stochastically.
+ If InverseCompton is used as well, pass it with setInverseCompton: the Thomson loss is then only applied below the
+ lowest energy of its tables, where it simulates no scatterings, so that the loss is not counted twice.
+ */
+class ContinuousEnergyLoss: public Module {
+private:
+    ref_ptr<MagneticField> field;
+    bool redshift; /* whether to update the redshift and apply the adiabatic loss */
+    double radiationDensity; /* energy density of the radiation field at z = 0 for the Thomson loss [J/m^3] */
+    ref_ptr<InverseCompton> inverseCompton; /* stochastic scattering, the Thomson loss is only applied below its energies */
+    double limit; /* fraction of the energy loss length to limit the next step */
+
+    double lossCoefficient(const Vector3d &position, const Vector3d &direction, double z, double E,
+            Candidate *candidate = NULL) const;
+
+public:
+    ContinuousEnergyLoss(bool redshift = true, double limit = 1);
+    void setMagneticField(ref_ptr<MagneticField> field);
+    void setRedshift(bool redshift);
+
+    /**
+     Enable the inverse Compton loss in the Thomson limit, dE/dx = 4/3 sigma_T U gamma^2
+     @param density  energy density of the radiation field at z = 0, 0 to disable; the CMB has 0.26 eV/cm^3
+     */
+    void setRadiationDensity(double density);
+
+    /** InverseCompton module in the same module list, which takes over the Thomson loss above its lowest energy */
+    void setInverseCompton(ref_ptr<InverseCompton> inverseCompton);
+    void setLimit(double limit);
+
+    /** Energy loss rate -dE/dx [J/m] at the current state of the candidate */
+    double energyLossRate(Candidate *candidate) const;
+
+    void process(Candidate *candidate) const;
+    std::string getDescription() const;
+};
+
+} // namespace grpropa
+
+#endif // GRPROPA_CONTINUOUSENERGYLOSS_H
@@ -0,0 +1,62 @@
+#ifndef GRPROPA_DIFFUSIONSDE_H
+#define GRPROPA_DIFFUSIONSDE_H
+
+#include "grpropa/Module.h"
+#include "grpropa/Units.h"
+#include "grpropa/magneticField/MagneticField.h"
+#include "grpropa/magneticField/TurbulentMagneticField.h"
+
+namespace grpropa {
+
+/**
+ @class DiffusionSDE
+ @brief Diffusive propagation of charged particles with small gyroradii in turbulent fields.
+
+ Particles whose gyroradius r_g in the RMS field is much smaller than the correlation length L_c of the turbulence
+ scatter many times per step, so resolving their orbits is wasted effort.
+ For r_g < ratio * L_c this module solves the stochastic differential equation of spatial diffusion instead,
+ otherwise the step is passed on to the given orbit propagation module (e.g. PropagationCK), which is also used
+ for neutral particles, so the particles switch back as soon as their gyroradius grows above the threshold.\n
+ The parallel mean free path follows from quasi-linear theory, lambda = L_c (r_g / L_c)^(2 - q),
+ with q = -(spectral index) - 2 the index of the one-dimensional turbulence spectrum (q = 5/3 for Kolmogorov),
+ and D_par = c lambda / 3, D_perp = epsilon D_par.
+ Without a background field the diffusion is isotropic with D_par, otherwise it is anisotropic with respect to the
+ direction of the background field at the start of the step; gradients of the diffusion tensor are neglected.
+ The step is at least one mean free path, the resolution of the diffusion picture, and the direction after the step is isotropic.
+ */
+class DiffusionSDE: public Module {
+private:
+    ref_ptr<TurbulentMagneticField> turbulence;
+    ref_ptr<MagneticField> background;
+    ref_ptr<Module> orbitPropagation;
+    double ratio; /*< maximum gyroradius in units of the correlation length for diffusive propagation */
+    double epsilon; /*< ratio of perpendicular to parallel diffusion coefficient */
+    double maxStep; /*< maximum step size of the diffusive propagation */
+
+public:
+    DiffusionSDE(ref_ptr<TurbulentMagneticField> turbulence, ref_ptr<Module> orbitPropagation, double ratio = 0.01, double epsilon = 0.1, double maxStep = 1 * Mpc);
+    void process(Candidate *candidate) const;
+
+    /** Gyroradius in the RMS field of the turbulence */
+    double gyroradius(const ParticleState &particle) const;
+    /** Parallel mean free path of a particle with the given gyroradius */
+    double meanFreePath(double gyroradius) const;
+    /** Whether the particle is propagated diffusively */
+    bool isDiffusive(const ParticleState &particle) const;
+
+    /** Regular background field that defines the parallel direction, none by default */
+    void setBackgroundField(ref_ptr<MagneticField> field);
+    void setOrbitPropagation(ref_ptr<Module> orbitPropagation);
+    void setRatio(double ratio);
+    void setEpsilon(double epsilon);
+    void setMaximumStep(double maxStep);
+
+    double getRatio() const;
+    double getEpsilon() const;
+    double getMaximumStep() const;
+    std::string getDescription() const;
+};
+
+} // namespace grpropa
+
+#endif // GRPROPA_DIFFUSIONSDE_H
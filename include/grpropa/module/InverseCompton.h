@@ -24,29 +24,66 @@ class InverseCompton: public Module {
 private:
     PhotonField photonField;
 
-    std::vector<double> tabEnergy; /* tabulated energy [eV] */
-    std::vector<double> tabRate; /* tabulated rate [1/Mpc] */
-    std::vector<double> tabRedshift; /* tabulated redshifts for z dependence of the IRB */
-    std::vector<double> tabPhotonEnergy; /* background photon energy*/
-    std::vector<double> tabProb; /* cumulative probability for background photon. */
+    TabulatedInteraction table; /* interaction rate and background photon tables */
+
 
     double thinning; /* number of secondaries to be tracked; if 1 only one secondary is tracked */
     double limit; /* fraction of energy loss length to limit the next step */
     double nMaxIterations; /* maximum number of attempts to sample s in energy fraction */
-    bool redshiftDependence; /* whether EBL model is redshift-dependent */
+    double cacheTolerance; /* relative change of energy and (1 + z) up to which a cached rate is reused */
     double Ethr;  /* energy loss due to the emission of soft photons for E<Ethr */
 
 public:
     InverseCompton(PhotonField photonField = CMB, double thinning = 0, double limit = 0.1, double Ethr = 1e6 * eV, double nMaxInteractions = 1000);
 
     void setPhotonField(PhotonField photonField);
+
+    /**
+     Compute the interaction tables from a custom photon field, see CustomPhotonField.
+     The tables are computed in parallel and can be dumped for reuse with InteractionTables::dump.
+     */
+    void setCustomPhotonField(ref_ptr<CustomPhotonField> field);
+
+    /** Use precomputed interaction tables; tables with a single redshift are scaled with (1 + z) like the CMB */
+    void setInteractionTables(ref_ptr<InteractionTables> tables);
+
+    /**
+     Resample the tables when they are loaded, to trade accuracy for a smaller memory footprint.
+     The rate table is resampled onto nEnergies logarithmically spaced energies, the background photon table
+     onto nProbabilities logarithmically spaced probabilities; 0 keeps the tabulated grid.
+     With singlePrecision the tables are stored as float.
+     The current tables are reloaded, the introduced error is available from getRateTableError and getPhotonTableError.
+     */
+    void setTableResolution(size_t nEnergies, size_t nProbabilities = 0, bool singlePrecision = false);
+
+    /** Maximum relative error of the interaction rates at the original table nodes */
+    double getRateTableError() const;
+
+    /** Maximum relative error of the background photon energies at the original table nodes */
+    double getPhotonTableError() const;
+
+    /** Lowest energy for which scatterings are simulated, below it the module has no effect */
+    double getMinimumEnergy() const;
     void setLimit(double limit);
     void setThinning(double thinning);
     void setThresholdEnergy(double Ethr);
     void setMaxNumberOfIterations(double nMaxIterations);
+
+    /**
+     Set the tolerance of the per-candidate rate cache.
+     The interaction rate of a candidate is only recalculated if its energy or (1 + z) changed
+     by more than this fraction since the last lookup, or if its particle ID changed.
+     A tolerance of 0 disables the cache.
+     */
+    void setCacheTolerance(double tolerance);
+    double getCacheTolerance() const;
     void initRate(std::string filename);
+    void applyTableResolution();
+    double tabulatedRate(double E, double z) const;
+    double tabulatedPhotonEnergy(double p, double z) const;
     void initTableBackgroundEnergy(std::string filename);
     void process(Candidate *candidate) const;
+    double interactionRate(Candidate *candidate) const;
     double lossLength(int id, double lf, double z) const;
     double energyLossBelowThreshold(double E, double z, double step) const; 
     double centerOfMassEnergy2(double E, double e, double mu) const; 
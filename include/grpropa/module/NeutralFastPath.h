@@ -0,0 +1,53 @@
+#ifndef GRPROPA_NEUTRALFASTPATH_H
+#define GRPROPA_NEUTRALFASTPATH_H
+
+#include "grpropa/Module.h"
+#include "grpropa/module/Observer.h"
+#include "grpropa/module/PairProduction.h"
+#include "grpropa/module/Redshift.h"
+
+#include <vector>
+
+namespace grpropa {
+
+/**
+ @class NeutralFastPath
+ @brief Moves neutral particles straight to the next observer or boundary in one step.
+
+ Neutral particles travel on straight lines, so the distance to the added observers and boundaries is known analytically
+ (see ObserverFeature::distanceToDetection and AbstractCondition::distanceToRejection).
+ If no interaction occurs on the way, the particle is moved there in one step, the redshift, energy and time are updated
+ as by Redshift, and the observers and boundaries are processed, so that the particle is detected or discarded at once.\n
+ Photons are only moved if an event-driven PairProduction (see setEventDriven) is set with setPairProduction and the
+ interaction point it sampled lies beyond the target, so the fast path is exact. Without it photons are left to the
+ regular propagation. Particles are not moved if any observer feature or boundary cannot give its distance.\n
+ Add this module last to the module list, after the observers and boundaries it is given.
+ Break conditions that are not added here, like MaximumTrajectoryLength, are only checked after the jump.
+ */
+class NeutralFastPath: public Module {
+private:
+    std::vector<ref_ptr<Observer> > observers;
+    std::vector<ref_ptr<AbstractCondition> > boundaries;
+    ref_ptr<PairProduction> pairProduction;
+    bool redshift; /* whether to apply the redshift */
+    Redshift redshiftModule;
+
+public:
+    NeutralFastPath(bool redshift = true);
+    void add(Observer *observer);
+    void add(AbstractCondition *boundary);
+
+    /** Pair production module that limits the fast path for photons; it has to be event-driven */
+    void setPairProduction(PairProduction *pairProduction);
+    void setRedshift(bool redshift);
+
+    /** Distance to the nearest observer or boundary along the straight line, -1 if unknown */
+    double distanceToTarget(const Vector3d &position, const Vector3d &direction) const;
+
+    void process(Candidate *candidate) const;
+    std::string getDescription() const;
+};
+
+} // namespace grpropa
+
+#endif // GRPROPA_NEUTRALFASTPATH_H
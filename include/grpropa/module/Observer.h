@@ -28,6 +28,20 @@ public:
     virtual DetectionState checkDetection(Candidate *candidate) const;
     virtual void onDetection(Candidate *candidate) const;
     virtual std::string getDescription() const;
+
+    /**
+     Distance along a straight line from position in direction to the next point where the detection state may change,
+     std::numeric_limits<double>::infinity() if it never does, or -1 if the feature cannot tell (the default).
+     Used to move neutral particles in one step, see NeutralFastPath.
+     */
+    virtual double distanceToDetection(const Vector3d &position, const Vector3d &direction) const;
+
+    /**
+     Fraction of the current step (from Candidate::previous to Candidate::current) at which a detected particle
+     crossed the detection surface, 1 by default.
+     Particles deactivated on detection are moved back to this point, see Candidate::interpolateCurrentState.
+     */
+    virtual double crossingFraction(const Candidate *candidate) const;
 };
 
 /**
@@ -50,6 +64,9 @@ public:
     std::string getDescription() const;
     void setFlag(std::string key, std::string value);
     void setDeactivateOnDetection(bool deactivate);
+
+    /** Minimum distance to detection of all features, -1 if any of them cannot tell */
+    double distanceToDetection(const Vector3d &position, const Vector3d &direction) const;
 };
 
 /**
@@ -60,11 +77,14 @@ class ObserverDetectAll: public ObserverFeature {
 public:
     DetectionState checkDetection(Candidate *candidate) const;
     std::string getDescription() const;
+    double distanceToDetection(const Vector3d &position, const Vector3d &direction) const;
 };
 
 /**
  @class ObserverSmallSphere
  @brief Detects particles upon entering a sphere
+ The step from the previous to the current position is tested against the sphere, so particles passing through it
+ within one step are detected as well and the step size is not limited.
  */
 class ObserverSmallSphere: public ObserverFeature {
 private:
@@ -74,6 +94,8 @@ public:
     ObserverSmallSphere(Vector3d center = Vector3d(0.), double radius = 0);
     DetectionState checkDetection(Candidate *candidate) const;
     std::string getDescription() const;
+    double distanceToDetection(const Vector3d &position, const Vector3d &direction) const;
+    double crossingFraction(const Candidate *candidate) const;
 };
 
 /**
@@ -89,11 +111,13 @@ public:
     ObserverTracking(Vector3d center, double radius, double stepSize = 0);
     DetectionState checkDetection(Candidate *candidate) const;
     std::string getDescription() const;
+    double distanceToDetection(const Vector3d &position, const Vector3d &direction) const;
 };
 
 /**
  @class ObserverLargeSphere
  @brief Detects particles upon exiting a sphere
+ The step size is not limited, particles deactivated on detection are moved back onto the sphere.
  */
 class ObserverLargeSphere: public ObserverFeature {
 private:
@@ -103,18 +127,22 @@ public:
     ObserverLargeSphere(Vector3d center = Vector3d(0.), double radius = 0);
     DetectionState checkDetection(Candidate *candidate) const;
     std::string getDescription() const;
+    double distanceToDetection(const Vector3d &position, const Vector3d &direction) const;
+    double crossingFraction(const Candidate *candidate) const;
 };
 
 /**
  @class ObserverPoint
  @brief Detects particles when reaching x = 0
- This module limits the next step size to prevent candidates from overshooting.
+ Particles deactivated on detection are moved back to x = 0, so the step size is not limited.
  Should be renamed to Observer1D, once old observer-scheme is removed.
  */
 class ObserverPoint: public ObserverFeature {
 public:
     DetectionState checkDetection(Candidate *candidate) const;
     std::string getDescription() const;
+    double distanceToDetection(const Vector3d &position, const Vector3d &direction) const;
+    double crossingFraction(const Candidate *candidate) const;
 };
 
 /**
@@ -128,6 +156,7 @@ public:
     ObserverRedshiftWindow(double zmin = 0, double zmax = 0.1);
     DetectionState checkDetection(Candidate *candidate) const;
     std::string getDescription() const;
+    double distanceToDetection(const Vector3d &position, const Vector3d &direction) const;
 };
 
 /**
@@ -138,6 +167,7 @@ class ObserverInactiveVeto: public ObserverFeature {
 public:
     DetectionState checkDetection(Candidate *candidate) const;
     std::string getDescription() const;
+    double distanceToDetection(const Vector3d &position, const Vector3d &direction) const;
 };
 
 /**
@@ -148,6 +178,7 @@ class ObserverNeutrinoVeto: public ObserverFeature {
 public:
     DetectionState checkDetection(Candidate *candidate) const;
     std::string getDescription() const;
+    double distanceToDetection(const Vector3d &position, const Vector3d &direction) const;
 };
 
 /**
@@ -158,6 +189,7 @@ class ObserverPhotonVeto: public ObserverFeature {
 public:
     DetectionState checkDetection(Candidate *candidate) const;
     std::string getDescription() const;
+    double distanceToDetection(const Vector3d &position, const Vector3d &direction) const;
 };
 
 /**
@@ -168,6 +200,7 @@ class ObserverElectronVeto: public ObserverFeature {
 public:
     DetectionState checkDetection(Candidate *candidate) const;
     std::string getDescription() const;
+    double distanceToDetection(const Vector3d &position, const Vector3d &direction) const;
 };
 
 } // namespace grpropa
@@ -20,27 +20,87 @@ class PairProduction: public Module {
 private:
     PhotonField photonField;
 
-    std::vector<double> tabEnergy; /* tabulated energy [eV] */
-    std::vector<double> tabRate; /* tabulated rate [1/Mpc] */
-    std::vector<double> tabRedshift; /* tabulated redshifts for z dependence of the IRB */
-    std::vector<double> tabPhotonEnergy; /* background photon energy*/
-    std::vector<double> tabProb; /* cumulative probability for background photon. */
+    TabulatedInteraction table; /* interaction rate and background photon tables */
+
 
     double thinning; /* number of secondaries to be tracked; if 1 only one secondary is tracked */
     double limit; /* fraction of energy loss length to limit the next step */
     double nMaxIterations; /* maximum number of attempts to sample s in energy fraction */
-    bool redshiftDependence; /* whether EBL model is redshift-dependent */
-    
+    double cacheTolerance; /* relative change of energy and (1 + z) up to which a cached rate is reused */
+
+    bool eventDriven; /* whether interaction points are sampled from the cumulative optical depth */
+    std::vector<double> tabOpticalDepth; /* optical depth from z = 0 to z, tabOpticalDepth[iEnergy * nDepthRedshifts + iRedshift] */
+    size_t nDepthEnergies, nDepthRedshifts;
+    double depthEnergyMin, depthEnergyMax; /* range of E / (1 + z) of the optical depth table */
+    double depthRedshiftMax; /* maximum redshift of the optical depth table */
+
 public:
     PairProduction(PhotonField photonField = CMB, double thinning = 0., double limit = 0.1, double nMaxIterations = 1000);
 
     void setPhotonField(PhotonField photonField);
+
+    /**
+     Compute the interaction tables from a custom photon field, see CustomPhotonField.
+     The tables are computed in parallel and can be dumped for reuse with InteractionTables::dump.
+     */
+    void setCustomPhotonField(ref_ptr<CustomPhotonField> field);
+
+    /** Use precomputed interaction tables; tables with a single redshift are scaled with (1 + z) like the CMB */
+    void setInteractionTables(ref_ptr<InteractionTables> tables);
+
+    /**
+     Resample the tables when they are loaded, to trade accuracy for a smaller memory footprint.
+     The rate table is resampled onto nEnergies logarithmically spaced energies, the background photon table
+     onto nProbabilities logarithmically spaced probabilities; 0 keeps the tabulated grid.
+     With singlePrecision the tables are stored as float.
+     The current tables are reloaded, the introduced error is available from getRateTableError and getPhotonTableError.
+     */
+    void setTableResolution(size_t nEnergies, size_t nProbabilities = 0, bool singlePrecision = false);
+
+    /** Maximum relative error of the interaction rates at the original table nodes */
+    double getRateTableError() const;
+
+    /** Maximum relative error of the background photon energies at the original table nodes */
+    double getPhotonTableError() const;
     void setLimit(double limit);
     void setThinning(double thinning);
     void setMaxNumberOfIterations(double nMaxIterations);
+
+    /**
+     Event-driven transport: instead of limiting the step to a fraction of the mean free path,
+     the interaction point of each photon is sampled once from the cumulative optical depth including the
+     cosmological evolution of energy and photon field, and the next step is limited to end exactly there.
+     The optical depth is tabulated in E / (1 + z), which is conserved under adiabatic losses, up to zmax.
+     Photons outside of the table fall back to the stepwise algorithm.
+     Use with Redshift or ContinuousEnergyLoss placed before this module; both update the redshift exactly also for long steps.
+     */
+    void setEventDriven(bool eventDriven, double zmax = 10);
+    bool isEventDriven() const;
+
+    /** Optical depth for a photon of energy E at redshift z travelling the comoving distance towards z = 0; requires the event-driven table */
+    double opticalDepth(double E, double z, double distance) const;
+
+    /** Comoving distance after which a photon of energy E at redshift z accumulates the optical depth tau; requires the event-driven table */
+    double interactionDistance(double E, double z, double tau) const;
+
+    /**
+     Set the tolerance of the per-candidate rate cache.
+     The interaction rate of a candidate is only recalculated if its energy or (1 + z) changed
+     by more than this fraction since the last lookup, or if its particle ID changed.
+     A tolerance of 0 disables the cache.
+     */
+    void setCacheTolerance(double tolerance);
+    double getCacheTolerance() const;
     void initTableBackgroundEnergy(std::string filename);
     void initRate(std::string filename);
+    void applyTableResolution();
+    void initOpticalDepth();
+    double cumulativeOpticalDepth(double eps, double z) const;
+    bool processEventDriven(Candidate *candidate) const;
+    double tabulatedRate(double E, double z) const;
+    double tabulatedPhotonEnergy(double p, double z) const;
     void process(Candidate *candidate) const;
+    double interactionRate(Candidate *candidate) const;
     double centerOfMassEnergy2(double E, double e, double mu) const; 
     double energyFraction(double E, double z) const;
     double lossLength(int id, double en, double z) const;
@@ -0,0 +1,53 @@
+#ifndef GRPROPA_PROPAGATIONBP_H
+#define GRPROPA_PROPAGATIONBP_H
+
+#include "grpropa/Module.h"
+#include "grpropa/Units.h"
+#include "grpropa/magneticField/MagneticField.h"
+
+namespace grpropa {
+
+/**
+ @class PropagationBP
+ @brief Propagation through magnetic fields using the Boris push.
+
+ This module solves the equations of motion of a relativistic charged particle when propagating through a magnetic field.\n
+ Each step is a drift of half a step, a rotation of the direction in the field at the midpoint and another half-step drift.
+ This needs one field evaluation per step, is volume-preserving and conserves the length of the direction vector exactly,
+ which makes it well suited for electrons and positrons that gyrate many times in turbulent fields.\n
+ The phase error of the rotation by an angle theta is about theta^3 / 12 per step.
+ The step size is chosen such that this error stays below the designated tolerance, given the field at the midpoint.
+ Additionally a minimum and maximum size for the steps can be set.
+ For neutral particles a rectilinear propagation is applied and a next step of the maximum step size proposed.
+ */
+class PropagationBP: public Module {
+private:
+    ref_ptr<MagneticField> field;
+    double tolerance; /*< target phase error per step */
+    double minStep; /*< minimum step size of the propagation */
+    double maxStep; /*< maximum step size of the propagation */
+
+public:
+    PropagationBP(ref_ptr<MagneticField> field = NULL, double tolerance = 1e-4, double minStep = 0.1 * kpc, double maxStep = 1 * Mpc);
+    void process(Candidate *candidate) const;
+
+    /**
+     Boris step of length step [m] from position x with unit direction u.
+     Returns the gyration angle of the step, the new position and direction are written to x and u.
+     */
+    double tryStep(Vector3d &x, Vector3d &u, double step, const ParticleState &p) const;
+
+    void setField(ref_ptr<MagneticField> field);
+    void setTolerance(double tolerance);
+    void setMinimumStep(double minStep);
+    void setMaximumStep(double maxStep);
+
+    double getTolerance() const;
+    double getMinimumStep() const;
+    double getMaximumStep() const;
+    std::string getDescription() const;
+};
+
+} // namespace grpropa
+
+#endif // GRPROPA_PROPAGATIONBP_H
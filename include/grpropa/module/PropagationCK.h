@@ -14,6 +14,8 @@ namespace grpropa {
  This module solves the equations of motion of a relativistic charged particle when propagating through a magnetic field.\n
  It uses the Runge-Kutta integration method with Cash-Karp coefficients.\n
  The step size control tries to keep the relative error close to, but smaller than the designated tolerance.
+ Failed trial steps are repeated with a smaller step, reusing the derivative at the start point.
+ The field at the start point is taken from the candidate's field cache if another module has evaluated it there.
  Additionally a minimum and maximum size for the steps can be set.
  For neutral particles a rectilinear propagation is applied and a next step of the maximum step size proposed.
  */
@@ -46,7 +48,6 @@ public:
     };
 
 private:
-    std::vector<double> a, b, bs; /*< Cash-Karp coefficients */
     ref_ptr<MagneticField> field;
     double tolerance; /*< target relative error of the numerical integration */
     double minStep; /*< minimum step size of the propagation */
@@ -60,9 +61,14 @@ public:
     // derivative of phase point, dY/dt = d/dt(x, u) = (v, du/dt)
     // du/dt = q*c^2/E * (u x B)
     Y dYdt(const Y &y, ParticleState &p) const;
+    /** Derivative with the field B at y already known */
+    Y dYdt(const Y &y, ParticleState &p, const Vector3d &B) const;
 
     void tryStep(const Y &y, Y &out, Y &error, double t, ParticleState &p) const;
 
+    /** Trial step with the derivative at the start point given, so that it is shared by repeated trials */
+    void tryStep(const Y &y, const Y &dydt, Y &out, Y &error, double t, ParticleState &p) const;
+
     void setField(ref_ptr<MagneticField> field);
     void setTolerance(double tolerance);
     void setMinimumStep(double minStep);
@@ -0,0 +1,66 @@
+#ifndef GRPROPA_PROPAGATIONDP_H
+#define GRPROPA_PROPAGATIONDP_H
+
+#include "grpropa/Module.h"
+#include "grpropa/Units.h"
+#include "grpropa/magneticField/MagneticField.h"
+#include "grpropa/module/PropagationCK.h"
+
+namespace grpropa {
+
+/**
+ @class PropagationDP
+ @brief Propagation through magnetic fields using the Dormand-Prince method.
+
+ This module solves the equations of motion of a relativistic charged particle when propagating through a magnetic field.\n
+ It uses the Runge-Kutta integration method with the Dormand-Prince 5(4) coefficients.
+ The last stage is evaluated at the end point of the step (first same as last), so it gives the embedded error estimate
+ at no extra cost, and the derivative at the start point is shared by repeated trial steps.
+ The field at the end point is stored in the candidate's field cache, where the next step and other modules
+ like Synchrotron find it.\n
+ The step size is chosen by a proportional-integral controller, which takes the error of the previous accepted step
+ into account (see Candidate::getStepError) and changes the step size more smoothly than PropagationCK.
+ Additionally a minimum and maximum size for the steps can be set.
+ For neutral particles a rectilinear propagation is applied and a next step of the maximum step size proposed.
+ */
+class PropagationDP: public Module {
+public:
+    typedef PropagationCK::Y Y;
+
+private:
+    ref_ptr<MagneticField> field;
+    double tolerance; /*< target relative error of the numerical integration */
+    double minStep; /*< minimum step size of the propagation */
+    double maxStep; /*< maximum step size of the propagation */
+    int nMaxIterations;
+
+public:
+    PropagationDP(ref_ptr<MagneticField> field = NULL, double tolerance = 1e-3, double minStep = 0.1 * kpc, double maxStep = 1 * Mpc, int nMaxIterations = 10000);
+    void process(Candidate *candidate) const;
+
+    // derivative of phase point, dY/dt = d/dt(x, u) = (v, du/dt)
+    // du/dt = q*c^2/E * (u x B)
+    Y dYdt(const Y &y, ParticleState &p) const;
+    /** Derivative with the field B at y already known */
+    Y dYdt(const Y &y, ParticleState &p, const Vector3d &B) const;
+
+    /**
+     Trial step of size t [s] from y with derivative dydt at y.
+     Returns the field at the end point in fieldOut, which is needed again for the first stage of the next step.
+     */
+    void tryStep(const Y &y, const Y &dydt, Y &out, Vector3d &fieldOut, Y &error, double t, ParticleState &p) const;
+
+    void setField(ref_ptr<MagneticField> field);
+    void setTolerance(double tolerance);
+    void setMinimumStep(double minStep);
+    void setMaximumStep(double maxStep);
+
+    double getTolerance() const;
+    double getMinimumStep() const;
+    double getMaximumStep() const;
+    std::string getDescription() const;
+};
+
+} // namespace grpropa
+
+#endif // GRPROPA_PROPAGATIONDP_H
@@ -0,0 +1,70 @@
+#ifndef GRPROPA_PROPAGATIONGUIDINGCENTER_H
+#define GRPROPA_PROPAGATIONGUIDINGCENTER_H
+
+#include "grpropa/Module.h"
+#include "grpropa/Units.h"
+#include "grpropa/magneticField/MagneticField.h"
+
+namespace grpropa {
+
+/**
+ @class PropagationGuidingCenter
+ @brief Propagation of the guiding center of charged particles in smooth magnetic fields.
+
+ If the field changes little over a gyroradius, only the motion of the guiding center matters:
+ along the field line with the parallel velocity, plus the gradient and curvature drifts,
+ while the magnetic moment (1 - mu^2) / B is conserved (mu is the cosine of the pitch angle), which gives the mirror force.
+ This module integrates these equations with the Runge-Kutta 4 method and steps that are a fraction of the length scale
+ on which the field changes, independent of the gyroradius.
+ The field gradient and curvature are calculated from finite differences over one gyroradius.\n
+ The candidate keeps the position and direction of the particle itself: at the start of each step the guiding center
+ is calculated from them, and after the step they are reconstructed from the new guiding center and pitch angle,
+ advancing the gyration phase.
+ If the adiabaticity parameter r_g * max(|grad B| / B, |curvature|) exceeds the given limit,
+ the step is passed on to the orbit propagation module (e.g. PropagationCK) instead.
+ For neutral particles a rectilinear propagation is applied.
+ */
+class PropagationGuidingCenter: public Module {
+private:
+    ref_ptr<MagneticField> field;
+    ref_ptr<Module> orbitPropagation;
+    double adiabaticity; /*< maximum r_g / (field length scale) for guiding center propagation */
+    double accuracy; /*< maximum step in units of the field length scale */
+    double minStep; /*< minimum step size of the propagation */
+    double maxStep; /*< maximum step size of the propagation */
+
+    struct State {
+        Vector3d R; /* guiding center */
+        double mu; /* cosine of the pitch angle */
+    };
+
+    /**
+     Derivative of the guiding center state with respect to the path length.
+     @param rg        r_g of the particle in units of the field strength, E / (q c), with sign
+     @param scale     set to the length scale of the field, 1 / max(|grad B| / B, |curvature|)
+     @param b         set to the field direction at the guiding center
+     @param B         set to the field strength at the guiding center
+     */
+    State derivative(const State &s, double rg, double &scale, Vector3d &b, double &B) const;
+
+public:
+    PropagationGuidingCenter(ref_ptr<MagneticField> field, ref_ptr<Module> orbitPropagation, double adiabaticity = 0.01, double accuracy = 0.05, double minStep = 0.1 * kpc, double maxStep = 1 * Mpc);
+    void process(Candidate *candidate) const;
+
+    void setField(ref_ptr<MagneticField> field);
+    void setOrbitPropagation(ref_ptr<Module> orbitPropagation);
+    void setAdiabaticity(double adiabaticity);
+    void setAccuracy(double accuracy);
+    void setMinimumStep(double minStep);
+    void setMaximumStep(double maxStep);
+
+    double getAdiabaticity() const;
+    double getAccuracy() const;
+    double getMinimumStep() const;
+    double getMaximumStep() const;
+    std::string getDescription() const;
+};
+
+} // namespace grpropa
+
+#endif // GRPROPA_PROPAGATIONGUIDINGCENTER_H
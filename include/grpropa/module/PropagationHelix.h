@@ -0,0 +1,59 @@
+#ifndef GRPROPA_PROPAGATIONHELIX_H
+#define GRPROPA_PROPAGATIONHELIX_H
+
+#include "grpropa/Module.h"
+#include "grpropa/Units.h"
+#include "grpropa/magneticField/MagneticField.h"
+#include "grpropa/magneticField/MagneticFieldGrid.h"
+
+namespace grpropa {
+
+/**
+ @class PropagationHelix
+ @brief Exact propagation along helices in piecewise constant magnetic fields.
+
+ In a constant magnetic field the trajectory of a charged particle is a helix, which this module follows analytically
+ instead of integrating the equations of motion numerically.
+ Supported are the UniformMagneticField and a MagneticFieldGrid in nearest-cell mode (MagneticFieldGrid::setNearestCell),
+ where the field is constant within each grid cell.
+ For the latter each step ends where the helix leaves the current cell, or earlier if the step is limited otherwise.
+ Since no accuracy is lost, the next step proposed is the maximum step size.
+ For neutral particles a rectilinear propagation is applied.
+ */
+class PropagationHelix: public Module {
+private:
+    ref_ptr<MagneticField> field;
+    ref_ptr<VectorGrid> grid; /* grid of a nearest-cell MagneticFieldGrid, null for a uniform field */
+    double minStep; /*< minimum step size of the propagation */
+    double maxStep; /*< maximum step size of the propagation */
+
+public:
+    PropagationHelix(ref_ptr<MagneticField> field, double minStep = 0.1 * kpc, double maxStep = 1 * Mpc);
+    void process(Candidate *candidate) const;
+
+    /**
+     Move a particle along the helix in a constant field.
+     @param x       position, set to the position after the step
+     @param u       unit direction, set to the direction after the step
+     @param B       magnetic field
+     @param k       charge * c / energy of the particle, so that du/ds = k (u x B)
+     @param step    length of the step
+     */
+    static void helixStep(Vector3d &x, Vector3d &u, const Vector3d &B, double k, double step);
+
+    /** Path length along the helix until it leaves the grid cell that contains x, at most smax */
+    double distanceToCellExit(const Vector3d &x, const Vector3d &u, const Vector3d &B, double k, double smax) const;
+
+    /** Only UniformMagneticField and MagneticFieldGrid in nearest-cell mode are supported */
+    void setField(ref_ptr<MagneticField> field);
+    void setMinimumStep(double minStep);
+    void setMaximumStep(double maxStep);
+
+    double getMinimumStep() const;
+    double getMaximumStep() const;
+    std::string getDescription() const;
+};
+
+} // namespace grpropa
+
+#endif // GRPROPA_PROPAGATIONHELIX_H
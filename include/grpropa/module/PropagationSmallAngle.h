@@ -0,0 +1,54 @@
+#ifndef GRPROPA_PROPAGATIONSMALLANGLE_H
+#define GRPROPA_PROPAGATIONSMALLANGLE_H
+
+#include "grpropa/Module.h"
+#include "grpropa/Units.h"
+#include "grpropa/magneticField/MagneticField.h"
+
+namespace grpropa {
+
+/**
+ @class PropagationSmallAngle
+ @brief Straight steps with stochastic small-angle deflections of charged particles.
+
+ For high-energy electrons in weak intergalactic fields the deflection per step is tiny, so instead of integrating the
+ Lorentz force each step is taken along a straight line and followed by a deflection, as in ELMAG.
+ The deflection is derived from the local field strength B at the start of the step and the correlation length L_c:
+ steps shorter than L_c are rotated coherently about the local field by the angle s / r_g,
+ longer steps get a random Gaussian deflection with <theta^2> = 2/3 s L_c / r_g^2 (random walk through s / L_c cells)
+ and the correlated lateral displacement of the random walk.\n
+ The step is limited such that the expected deflection stays below a maximum angle, so at low energies the
+ module takes many small steps and an orbit integrator like PropagationCK is more efficient.
+ For neutral particles a rectilinear propagation is applied.
+ */
+class PropagationSmallAngle: public Module {
+private:
+    ref_ptr<MagneticField> field;
+    double correlationLength; /*< coherence length of the field */
+    double maxAngle; /*< maximum expected deflection per step */
+    double minStep; /*< minimum step size of the propagation */
+    double maxStep; /*< maximum step size of the propagation */
+
+public:
+    PropagationSmallAngle(ref_ptr<MagneticField> field, double correlationLength, double maxAngle = 0.1, double minStep = 0.1 * kpc, double maxStep = 1 * Mpc);
+    void process(Candidate *candidate) const;
+
+    /** Root mean square deflection angle after a straight path of length step with a gyroradius of rg */
+    double deflectionAngle(double step, double rg) const;
+
+    void setField(ref_ptr<MagneticField> field);
+    void setCorrelationLength(double correlationLength);
+    void setMaximumAngle(double maxAngle);
+    void setMinimumStep(double minStep);
+    void setMaximumStep(double maxStep);
+
+    double getCorrelationLength() const;
+    double getMaximumAngle() const;
+    double getMinimumStep() const;
+    double getMaximumStep() const;
+    std::string getDescription() const;
+};
+
+} // namespace grpropa
+
+#endif // GRPROPA_PROPAGATIONSMALLANGLE_H
@@ -8,9 +8,14 @@ namespace grpropa {
 /**
  @class Redshift
  @brief Updates redshift and applies adiabatic energy loss according to the travelled distance.
+
+ The update is exact also for long steps, and the cosmic time advances by the light travel time between the redshifts.
  */
 class Redshift: public Module {
 public:
+    /** Replace the time of a comoving step between the redshifts z0 and z1 by the light travel time */
+    static void updateCosmicTime(Candidate *candidate, double z0, double z1, double step);
+
     void process(Candidate *candidate) const;
     std::string getDescription() const;
 };
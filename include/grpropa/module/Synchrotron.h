@@ -4,23 +4,91 @@
 #include "grpropa/Module.h"
 #include "grpropa/magneticField/MagneticField.h"
 
+#include <string>
+#include <vector>
+
 namespace grpropa {
 
+/**
+ @class SynchrotronHistogram
+ @brief Histogram of the energy emitted as synchrotron photons, binned in photon energy and direction.
+
+ The photon energy is binned logarithmically, the direction of emission in cos(theta) and phi of the global frame.
+ Filling is thread safe, so one histogram can be shared by all threads.
+ */
+class SynchrotronHistogram: public Referenced {
+private:
+    double Emin, Emax; /* photon energy range [J] */
+    size_t nEnergy, nCosTheta, nPhi;
+    std::vector<double> bins; /* emitted energy [J], bins[iEnergy * nCosTheta * nPhi + iCosTheta * nPhi + iPhi] */
+
+public:
+    SynchrotronHistogram(double Emin, double Emax, size_t nEnergy, size_t nCosTheta = 1, size_t nPhi = 1);
+
+    /** Photon energy at the lower edge of bin i, i = nEnergy gives the upper edge of the last bin */
+    double getEnergyEdge(size_t i) const;
+    size_t getNumberOfEnergyBins() const;
+    size_t getNumberOfDirectionBins() const;
+    /** Index of the direction bin of a given direction */
+    size_t getDirectionBin(const Vector3d &direction) const;
+
+    /** Add energy to a bin */
+    void add(size_t iEnergy, size_t iDirection, double energy);
+    double getEmittedEnergy(size_t iEnergy, size_t iDirection) const;
+    /** Emitted energy per energy bin, summed over all directions */
+    std::vector<double> getSpectrum() const;
+    /** Emitted energy per direction bin, summed over all photon energies */
+    std::vector<double> getAngularDistribution() const;
+    void clear();
+
+    /** Write the histogram as text: lower and upper edge of the energy bin [eV], then the emitted energy [eV] per direction bin */
+    void dump(std::string filename) const;
+};
 
 /**
  @class Synchrotron
- @brief Energy losses for electrons due to synchrotron emission.
+ @brief Energy losses and photon emission of electrons due to synchrotron radiation.
 
  See "Classical electrodynamics" by J. D. Jackson, eq. 14.31, pg. 667.
- This implementation only accounts for the radiated power. 
- The spectrum of radiated particles will be implemented in later versions of the code.
+ The emitted spectrum follows the synchrotron function F(x) = x int_x^inf K_5/3(t) dt, x = E_photon / E_critical,
+ which is tabulated using the approximation of Aharonian, Kelner & Prosekin, Phys. Rev. D 82 (2010) 043002.\n
+ Since the number of emitted photons is large, they are aggregated in one of two ways:
+ a small number of weighted representative photons per step (setNumberOfPhotons),
+ whose weights conserve the emitted energy, or a SynchrotronHistogram of the emitted energy (setHistogram).
+ By default only the energy loss is applied.
+ The field at the current position is shared with the propagation module through the candidate's field cache.
  */
 class Synchrotron: public Module {
 private:
     ref_ptr<MagneticField> Bfield;
     double limit;
+    size_t nPhotons; /* number of representative photons per step, 0 for no secondary photons */
+    double secondaryThreshold; /* minimum energy of emitted photons [J] */
+    ref_ptr<SynchrotronHistogram> histogram;
+
+    std::vector<double> tabX; /* x = E_photon / E_critical */
+    std::vector<double> tabCDF; /* fraction of the emitted energy below x */
+
+    void initSpectrum();
+    double energyFraction(double x) const;
+
 public:
     Synchrotron(ref_ptr<MagneticField> field, double limit = 0.1);
+    void setLimit(double limit);
+    void setNumberOfPhotons(size_t nPhotons);
+    void setSecondaryThreshold(double threshold);
+    void setHistogram(ref_ptr<SynchrotronHistogram> histogram);
+    ref_ptr<SynchrotronHistogram> getHistogram() const;
+
+    /** Synchrotron function F(x) */
+    static double synchrotronFunction(double x);
+
+    /** Critical photon energy E_c = 3/2 hbar gamma^2 e B_perp / m */
+    static double criticalEnergy(double lorentzFactor, double Bperp);
+
+    /** Draw a photon energy in units of the critical energy, distributed like the emitted energy, above xmin */
+    double samplePhotonEnergy(double xmin = 0) const;
+
     void process(Candidate *candidate) const;
 };
 
@@ -29,12 +29,20 @@ using std::ptrdiff_t;
 #include "grpropa/module/PairProduction.h"
 #include "grpropa/module/Synchrotron.h"
 #include "grpropa/module/Redshift.h"
+#include "grpropa/module/ContinuousEnergyLoss.h"
 #include "grpropa/module/BreakCondition.h"
 #include "grpropa/module/Boundary.h"
 #include "grpropa/module/Observer.h"
+#include "grpropa/module/NeutralFastPath.h"
 #include "grpropa/module/Output.h"
 #include "grpropa/module/SimplePropagation.h"
 #include "grpropa/module/PropagationCK.h"
+#include "grpropa/module/PropagationDP.h"
+#include "grpropa/module/PropagationBP.h"
+#include "grpropa/module/PropagationHelix.h"
+#include "grpropa/module/DiffusionSDE.h"
+#include "grpropa/module/PropagationSmallAngle.h"
+#include "grpropa/module/PropagationGuidingCenter.h"
 #include "grpropa/module/TextOutput.h"
 #include "grpropa/module/Tools.h"
 
@@ -43,6 +51,8 @@ using std::ptrdiff_t;
 #include "grpropa/magneticField/AMRMagneticField.h"
 #include "grpropa/magneticField/JF12Field.h"
 #include "grpropa/magneticField/TurbulentMagneticField.h"
+#include "grpropa/magneticField/ProceduralTurbulentField.h"
+#include "grpropa/magneticField/OctreeMagneticField.h"
 
 #include "grpropa/Referenced.h"
 #include "grpropa/Candidate.h"
@@ -57,6 +67,8 @@ using std::ptrdiff_t;
 #include "grpropa/Cosmology.h"
 #include "grpropa/PhotonBackground.h"
 #include "grpropa/Grid.h"
+#include "grpropa/CompressedGrid.h"
+#include "grpropa/TiledGrid.h"
 #include "grpropa/GridTools.h"
 %}
 
@@ -100,6 +112,10 @@ using std::ptrdiff_t;
 %include "grpropa/Units.h"
 %include "grpropa/Common.h"
 %include "grpropa/Cosmology.h"
+%implicitconv grpropa::ref_ptr<grpropa::CustomPhotonField>;
+%template(CustomPhotonFieldRefPtr) grpropa::ref_ptr<grpropa::CustomPhotonField>;
+%implicitconv grpropa::ref_ptr<grpropa::InteractionTables>;
+%template(InteractionTablesRefPtr) grpropa::ref_ptr<grpropa::InteractionTables>;
 %include "grpropa/PhotonBackground.h"
 %include "grpropa/Random.h"
 %include "grpropa/ParticleState.h"
@@ -147,21 +163,41 @@ using std::ptrdiff_t;
 %template(ScalarGridRefPtr) grpropa::ref_ptr<grpropa::Grid<float> >;
 %template(ScalarGrid) grpropa::Grid<float>;
 
+%implicitconv grpropa::ref_ptr<grpropa::CompressedVectorGrid>;
+%template(CompressedVectorGridRefPtr) grpropa::ref_ptr<grpropa::CompressedVectorGrid>;
+%include "grpropa/CompressedGrid.h"
+
+%implicitconv grpropa::ref_ptr<grpropa::TiledVectorGrid>;
+%template(TiledVectorGridRefPtr) grpropa::ref_ptr<grpropa::TiledVectorGrid>;
+%include "grpropa/TiledGrid.h"
+
 %include "grpropa/magneticField/MagneticFieldGrid.h"
 %include "grpropa/magneticField/AMRMagneticField.h"
 %include "grpropa/magneticField/JF12Field.h"
 %include "grpropa/magneticField/TurbulentMagneticField.h"
+%include "grpropa/magneticField/ProceduralTurbulentField.h"
+%include "grpropa/magneticField/OctreeMagneticField.h"
 
 %include "grpropa/module/BreakCondition.h"
 %include "grpropa/module/Boundary.h"
 %include "grpropa/module/Observer.h"
 %include "grpropa/module/SimplePropagation.h"
 %include "grpropa/module/PropagationCK.h"
+%include "grpropa/module/PropagationDP.h"
+%include "grpropa/module/PropagationBP.h"
+%include "grpropa/module/PropagationHelix.h"
+%include "grpropa/module/DiffusionSDE.h"
+%include "grpropa/module/PropagationSmallAngle.h"
+%include "grpropa/module/PropagationGuidingCenter.h"
 %include "grpropa/module/Output.h"
+%implicitconv grpropa::ref_ptr<grpropa::SynchrotronHistogram>;
+%template(SynchrotronHistogramRefPtr) grpropa::ref_ptr<grpropa::SynchrotronHistogram>;
 %include "grpropa/module/Synchrotron.h"
 %include "grpropa/module/InverseCompton.h"
 %include "grpropa/module/PairProduction.h"
 %include "grpropa/module/Redshift.h"
+%include "grpropa/module/NeutralFastPath.h"
+%include "grpropa/module/ContinuousEnergyLoss.h"
 %include "grpropa/module/TextOutput.h"
 %include "grpropa/module/Tools.h"
 
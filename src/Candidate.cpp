@@ -2,24 +2,30 @@
 #include "grpropa/Cosmology.h"
 #include "grpropa/Units.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace grpropa {
 
 
 Candidate::Candidate(int id, double E, Vector3d pos, Vector3d dir, double z, double weight) :
-        trajectoryLength(0), currentStep(0), nextStep(0), weight(0), active(true) {
+        trajectoryLength(0), currentStep(0), nextStep(0), stepError(1), weight(0), active(true), fieldCacheNext(0) {
+    fieldCache[0].field = fieldCache[1].field = 0;
     ParticleState state(id, E, pos, dir);
     source = state;
     created = state;
     previous = state;
     current = state;
     setRedshift(z);
+    previousRedshift = z;
     setWeight(weight);
     timeOfEmission = 1 / H0() - redshift2LightTravelDistance(z) / c_light;
     setCosmicTime(timeOfEmission);
 }
 
 Candidate::Candidate(const ParticleState &state) :
-        source(state), created(state), current(state), previous(state), redshift(0), trajectoryLength(0), currentStep(0), nextStep(0), active(true) {
+        source(state), created(state), current(state), previous(state), redshift(0), previousRedshift(0), trajectoryLength(0), currentStep(0), nextStep(0), stepError(1), active(true), fieldCacheNext(0) {
+    fieldCache[0].field = fieldCache[1].field = 0;
 }
 
 bool Candidate::isActive() const {
@@ -75,11 +81,47 @@ void Candidate::setTrajectoryLength(double a) {
 }
 
 void Candidate::setCurrentStep(double lstep) {
+    previousRedshift = redshift;
     currentStep = lstep;
     trajectoryLength += lstep;
     cosmicTime += lstep / current.getSpeed();
 }
 
+void Candidate::setStepError(double error) {
+    stepError = error;
+}
+
+double Candidate::getStepError() const {
+    return stepError;
+}
+
+void Candidate::interpolateCurrentState(double fraction) {
+    fraction = std::min(std::max(fraction, 0.), 1.);
+    double rest = (1 - fraction) * currentStep;
+
+    Vector3d pos0 = previous.getPosition();
+    current.setPosition(pos0 + (current.getPosition() - pos0) * fraction);
+    Vector3d dir = previous.getDirection() * (1 - fraction) + current.getDirection() * fraction;
+    if (dir.getR() > 0)
+        current.setDirection(dir / dir.getR());
+    if (current.getId() == previous.getId())
+        current.setEnergy(previous.getEnergy() + (current.getEnergy() - previous.getEnergy()) * fraction);
+
+    currentStep -= rest;
+    trajectoryLength -= rest;
+
+    // the redshift has already been advanced over the full step if the Redshift module was called before
+    if (redshift == previousRedshift) {
+        cosmicTime -= rest / current.getSpeed();
+        return;
+    }
+    double z = previousRedshift + (redshift - previousRedshift) * fraction;
+    if (previousRedshift > 0)
+        z = redshiftAfterComovingDistance(previousRedshift, currentStep);
+    cosmicTime -= rest / (1 + (z + redshift) / 2) / current.getSpeed();
+    redshift = z;
+}
+
 void Candidate::setNextStep(double step) {
     nextStep = step;
 }
@@ -92,6 +134,98 @@ void Candidate::limitNextStep(double step) {
     nextStep = std::min(nextStep, step);
 }
 
+bool Candidate::getCachedRate(const Module *owner, double tolerance, double &rate) const {
+    for (size_t i = 0; i < rateCache.size(); i++) {
+        const RateCache &entry = rateCache[i];
+        if (entry.owner != owner)
+            continue;
+        if (entry.id != current.getId())
+            return false;
+        if (std::fabs(current.getEnergy() - entry.energy) > tolerance * entry.energy)
+            return false;
+        if (std::fabs(redshift - entry.redshift) > tolerance * (1 + entry.redshift))
+            return false;
+        rate = entry.rate;
+        return true;
+    }
+    return false;
+}
+
+void Candidate::setCachedRate(const Module *owner, double rate) {
+    RateCache entry;
+    entry.owner = owner;
+    entry.id = current.getId();
+    entry.energy = current.getEnergy();
+    entry.redshift = redshift;
+    entry.rate = rate;
+    for (size_t i = 0; i < rateCache.size(); i++) {
+        if (rateCache[i].owner == owner) {
+            rateCache[i] = entry;
+            return;
+        }
+    }
+    rateCache.push_back(entry);
+}
+
+bool Candidate::getScheduledInteraction(const Module *owner, double &trajectoryLength) const {
+    for (size_t i = 0; i < scheduledInteractions.size(); i++) {
+        const ScheduledInteraction &entry = scheduledInteractions[i];
+        if (entry.owner != owner)
+            continue;
+        if (entry.id != current.getId())
+            return false;
+        double energy = current.getEnergy() / (1 + redshift);
+        if (std::fabs(energy - entry.energy) > 1e-6 * entry.energy)
+            return false;
+        trajectoryLength = entry.trajectoryLength;
+        return true;
+    }
+    return false;
+}
+
+void Candidate::setScheduledInteraction(const Module *owner, double trajectoryLength) {
+    ScheduledInteraction entry;
+    entry.owner = owner;
+    entry.id = current.getId();
+    entry.energy = current.getEnergy() / (1 + redshift);
+    entry.trajectoryLength = trajectoryLength;
+    for (size_t i = 0; i < scheduledInteractions.size(); i++) {
+        if (scheduledInteractions[i].owner == owner) {
+            scheduledInteractions[i] = entry;
+            return;
+        }
+    }
+    scheduledInteractions.push_back(entry);
+}
+
+void Candidate::clearScheduledInteraction(const Module *owner) {
+    for (size_t i = 0; i < scheduledInteractions.size(); i++) {
+        if (scheduledInteractions[i].owner == owner) {
+            scheduledInteractions.erase(scheduledInteractions.begin() + i);
+            return;
+        }
+    }
+}
+
+bool Candidate::getCachedField(const MagneticField *field, const Vector3d &position, Vector3d &value) const {
+    for (int i = 0; i < 2; i++) {
+        const FieldCache &entry = fieldCache[i];
+        if ((entry.field == field) and (entry.position == position)) {
+            value = entry.value;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Candidate::setCachedField(const MagneticField *field, const Vector3d &position, const Vector3d &value) {
+    FieldCache &entry = fieldCache[fieldCacheNext];
+    entry.field = field;
+    entry.position = position;
+    entry.value = value;
+    fieldCacheNext = 1 - fieldCacheNext;
+}
+
 void Candidate::setProperty(const std::string &name, const std::string &value) {
     properties[name] = value;
 }
@@ -127,6 +261,7 @@ void Candidate::addSecondary(int id, double energy, double weight) {
     ref_ptr<Candidate> secondary = new Candidate;
     secondary->setWeight(weight);
     secondary->setRedshift(redshift);
+    secondary->previousRedshift = previousRedshift;
     secondary->setCosmicTime(cosmicTime);
     secondary->setTrajectoryLength(trajectoryLength);
     secondary->source = source;
@@ -141,6 +276,7 @@ void Candidate::addSecondary(int id, double energy, double weight) {
 void Candidate::addSecondary(int id, double energy, Vector3d position, double weight) {
     ref_ptr<Candidate> secondary = new Candidate;
     secondary->setRedshift(redshift);
+    secondary->previousRedshift = previousRedshift;
     secondary->setCosmicTime(cosmicTime);
     secondary->setTrajectoryLength(trajectoryLength - (current.getPosition() - position).getR());
     secondary->setWeight(weight);
@@ -178,11 +314,18 @@ ref_ptr<Candidate> Candidate::clone(bool recursive) const {
     cloned->active = active;
     cloned->weight = weight;
     cloned->redshift = redshift;
+    cloned->previousRedshift = previousRedshift;
     cloned->cosmicTime = cosmicTime;
     cloned->timeOfEmission = timeOfEmission;
     cloned->trajectoryLength = trajectoryLength;
     cloned->currentStep = currentStep;
     cloned->nextStep = nextStep;
+    cloned->stepError = stepError;
+    cloned->fieldCache[0] = fieldCache[0];
+    cloned->fieldCache[1] = fieldCache[1];
+    cloned->fieldCacheNext = fieldCacheNext;
+    cloned->rateCache = rateCache;
+    cloned->scheduledInteractions = scheduledInteractions;
     if (recursive) {
         cloned->secondaries.reserve(secondaries.size());
         for (size_t i = 0; i < secondaries.size(); i++) {
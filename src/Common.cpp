@@ -55,8 +55,9 @@ std::string getDataPath(std::string filename) {
     return concat_path(dataPath, filename);
 }
 
-double interpolate(double x, const std::vector<double> &X, const std::vector<double> &Y) {
-    std::vector<double>::const_iterator it = std::upper_bound(X.begin(), X.end(), x);
+template <typename T>
+static double interpolateTable(double x, const std::vector<T> &X, const std::vector<T> &Y) {
+    typename std::vector<T>::const_iterator it = std::upper_bound(X.begin(), X.end(), x);
     if (it == X.begin())
         return Y.front();
     if (it == X.end())
@@ -67,10 +68,11 @@ double interpolate(double x, const std::vector<double> &X, const std::vector<dou
 }
 
 
-double interpolate2d(double x, double y, const std::vector<double> &X, const std::vector<double> &Y, const std::vector<double> &Z) {
+template <typename T>
+static double interpolateTable2d(double x, double y, const std::vector<T> &X, const std::vector<T> &Y, const std::vector<T> &Z) {
 
-    std::vector<double>::const_iterator itx = std::upper_bound(X.begin(), X.end(), x);
-    std::vector<double>::const_iterator ity = std::upper_bound(Y.begin(), Y.end(), y);
+    typename std::vector<T>::const_iterator itx = std::upper_bound(X.begin(), X.end(), x);
+    typename std::vector<T>::const_iterator ity = std::upper_bound(Y.begin(), Y.end(), y);
 
     if (x > X.back() || x < X.front())
         return 0;
@@ -99,6 +101,22 @@ double interpolate2d(double x, double y, const std::vector<double> &X, const std
 
 }
 
+double interpolate(double x, const std::vector<double> &X, const std::vector<double> &Y) {
+    return interpolateTable(x, X, Y);
+}
+
+double interpolate(double x, const std::vector<float> &X, const std::vector<float> &Y) {
+    return interpolateTable(x, X, Y);
+}
+
+double interpolate2d(double x, double y, const std::vector<double> &X, const std::vector<double> &Y, const std::vector<double> &Z) {
+    return interpolateTable2d(x, y, X, Y, Z);
+}
+
+double interpolate2d(double x, double y, const std::vector<float> &X, const std::vector<float> &Y, const std::vector<float> &Z) {
+    return interpolateTable2d(x, y, X, Y, Z);
+}
+
 double interpolateEquidistant(double x, double lo, double hi, const std::vector<double> &Y) {
     if (x <= lo)
         return Y.front();
@@ -111,5 +129,38 @@ double interpolateEquidistant(double x, double lo, double hi, const std::vector<
     return Y[i] + (p - i) * (Y[i + 1] - Y[i]);
 }
 
+double resampleTable(const std::vector<double> &X, const std::vector<double> &Z, std::vector<double> &newX, std::vector<double> &newZ, bool singlePrecision) {
+    size_t n = X.size();
+    size_t m = newX.size();
+    size_t nColumns = Z.size() / n;
+
+    if (singlePrecision)
+        for (size_t j = 0; j < m; j++)
+            newX[j] = (float) newX[j];
+
+    newZ.resize(m * nColumns);
+    double error = 0;
+    std::vector<double> column(n), newColumn(m);
+    for (size_t i = 0; i < nColumns; i++) {
+        double maximum = 0;
+        for (size_t j = 0; j < n; j++) {
+            column[j] = Z[i * n + j];
+            maximum = std::max(maximum, fabs(column[j]));
+        }
+        for (size_t j = 0; j < m; j++) {
+            double z = interpolate(newX[j], X, column);
+            newColumn[j] = singlePrecision ? (float) z : z;
+            newZ[i * m + j] = newColumn[j];
+        }
+        for (size_t j = 0; j < n; j++) {
+            if (fabs(column[j]) < 1e-6 * maximum)
+                continue;
+            double z = interpolate(X[j], newX, newColumn);
+            error = std::max(error, fabs(z / column[j] - 1));
+        }
+    }
+    return error;
+}
+
 } // namespace grpropa
 
@@ -0,0 +1,303 @@
+#include "grpropa/CompressedGrid.h"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace grpropa {
+
+// IEEE half precision, rounded to nearest
+static unsigned short floatToHalf(float f) {
+    unsigned int u;
+    memcpy(&u, &f, sizeof(u));
+    unsigned short sign = (u >> 16) & 0x8000;
+    int exponent = int((u >> 23) & 0xff) - 127 + 15;
+    unsigned int mantissa = u & 0x7fffff;
+    if (exponent >= 31)
+        return sign | 0x7bff; // largest finite value
+    if (exponent <= 0) {
+        // subnormal or zero
+        if (exponent < -10)
+            return sign;
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        unsigned short h = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1)
+            h++;
+        return sign | h;
+    }
+    unsigned short h = sign | (exponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000)
+        h++; // a carry into the exponent is the correct rounding
+    return h;
+}
+
+static float halfToFloat(unsigned short h) {
+    unsigned int sign = (h & 0x8000) << 16;
+    unsigned int exponent = (h >> 10) & 0x1f;
+    unsigned int mantissa = h & 0x3ff;
+    if (exponent == 0) {
+        float f = ldexp(float(mantissa), -24);
+        return sign ? -f : f;
+    }
+    unsigned int u = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+CompressedVectorGrid::CompressedVectorGrid(Vector3d origin, size_t Nx, size_t Ny, size_t Nz, double spacing,
+        Encoding encoding, size_t brickSize) :
+        encoding(encoding), Nx(Nx), Ny(Ny), Nz(Nz), origin(origin), spacing(spacing), reflective(false) {
+    init(brickSize);
+}
+
+CompressedVectorGrid::CompressedVectorGrid(ref_ptr<VectorGrid> grid, Encoding encoding, size_t brickSize) :
+        encoding(encoding), Nx(grid->getNx()), Ny(grid->getNy()), Nz(grid->getNz()), origin(grid->getOrigin()),
+        spacing(grid->getSpacing()), reflective(grid->isReflective()) {
+    init(brickSize);
+    encode(grid);
+}
+
+void CompressedVectorGrid::init(size_t brickSize) {
+    brickBits = 0;
+    while ((size_t(1) << brickBits) < brickSize)
+        brickBits++;
+    if ((size_t(1) << brickBits) != brickSize)
+        throw std::runtime_error("CompressedVectorGrid: brick size must be a power of 2");
+
+    bytes = getBytesPerValue(encoding);
+
+    size_t B = size_t(1) << brickBits;
+    NBx = (Nx + B - 1) >> brickBits;
+    NBy = (Ny + B - 1) >> brickBits;
+    NBz = (Nz + B - 1) >> brickBits;
+    scales.assign(NBx * NBy * NBz, 0);
+    data.assign(scales.size() * B * B * B * 3 * bytes, 0);
+    gridOrigin = origin + Vector3d(spacing / 2);
+}
+
+size_t CompressedVectorGrid::index(size_t ix, size_t iy, size_t iz) const {
+    size_t mask = (size_t(1) << brickBits) - 1;
+    size_t brick = ((ix >> brickBits) * NBy + (iy >> brickBits)) * NBz + (iz >> brickBits);
+    size_t inner = (((ix & mask) << brickBits) + (iy & mask)) << brickBits | (iz & mask);
+    return (brick << (3 * brickBits)) + inner;
+}
+
+void CompressedVectorGrid::encode(ref_ptr<VectorGrid> grid) {
+    if ((grid->getNx() != Nx) or (grid->getNy() != Ny) or (grid->getNz() != Nz))
+        throw std::runtime_error("CompressedVectorGrid: grid size does not match");
+
+    size_t B = size_t(1) << brickBits;
+    std::vector<Vector3f> values(B * B * B);
+    for (size_t bx = 0; bx < NBx; bx++)
+        for (size_t by = 0; by < NBy; by++)
+            for (size_t bz = 0; bz < NBz; bz++) {
+                for (size_t i = 0; i < B; i++)
+                    for (size_t j = 0; j < B; j++)
+                        for (size_t k = 0; k < B; k++) {
+                            size_t ix = (bx << brickBits) + i;
+                            size_t iy = (by << brickBits) + j;
+                            size_t iz = (bz << brickBits) + k;
+                            if ((ix < Nx) and (iy < Ny) and (iz < Nz))
+                                values[(i * B + j) * B + k] = grid->get(ix, iy, iz);
+                        }
+                encodeBrick(bx, by, bz, &values[0]);
+            }
+}
+
+void CompressedVectorGrid::encodeBrick(size_t bx, size_t by, size_t bz, const Vector3f *values) {
+    size_t B = size_t(1) << brickBits;
+    size_t n = B * B * B;
+
+    // values outside of the grid are set to zero, so that they do not enter the scale
+    std::vector<float> c(3 * n);
+    for (size_t i = 0; i < n; i++) {
+        bool inside = ((bx << brickBits) + (i >> (2 * brickBits)) < Nx)
+                and ((by << brickBits) + ((i >> brickBits) & (B - 1)) < Ny)
+                and ((bz << brickBits) + (i & (B - 1)) < Nz);
+        Vector3f v = inside ? values[i] : Vector3f(0.);
+        c[3 * i] = v.x;
+        c[3 * i + 1] = v.y;
+        c[3 * i + 2] = v.z;
+    }
+
+    size_t brick = (bx * NBy + by) * NBz + bz;
+    scales[brick] = encodeValues(encoding, &c[0], 3 * n, &data[(brick << (3 * brickBits)) * 3 * bytes]);
+}
+
+Vector3f CompressedVectorGrid::get(size_t ix, size_t iy, size_t iz) const {
+    size_t i = index(ix, iy, iz);
+    float c[3];
+    decodeValues(encoding, &data[3 * i * bytes], scales[i >> (3 * brickBits)], 3, c);
+    return Vector3f(c[0], c[1], c[2]);
+}
+
+Vector3f CompressedVectorGrid::closestValue(const Vector3d &position) const {
+    Vector3d r = (position - gridOrigin) / spacing;
+    int ix = round(r.x);
+    int iy = round(r.y);
+    int iz = round(r.z);
+    int nx = Nx, ny = Ny, nz = Nz;
+    if (reflective) {
+        ix = reflectiveIndex(ix, nx);
+        iy = reflectiveIndex(iy, ny);
+        iz = reflectiveIndex(iz, nz);
+    } else {
+        ix = ((ix % nx) + nx) % nx;
+        iy = ((iy % ny) + ny) % ny;
+        iz = ((iz % nz) + nz) % nz;
+    }
+    return get(ix, iy, iz);
+}
+
+Vector3f CompressedVectorGrid::interpolate(const Vector3d &position) const {
+    // position on a unit grid
+    Vector3d r = (position - gridOrigin) / spacing;
+
+    // indices of lower and upper neighbors
+    int ix, iX, iy, iY, iz, iZ;
+    if (reflective) {
+        reflectiveClamp(r.x, Nx, ix, iX);
+        reflectiveClamp(r.y, Ny, iy, iY);
+        reflectiveClamp(r.z, Nz, iz, iZ);
+    } else {
+        periodicClamp(r.x, Nx, ix, iX);
+        periodicClamp(r.y, Ny, iy, iY);
+        periodicClamp(r.z, Nz, iz, iZ);
+    }
+
+    // linear fraction to lower and upper neighbors
+    double fx = r.x - floor(r.x);
+    double fX = 1 - fx;
+    double fy = r.y - floor(r.y);
+    double fY = 1 - fy;
+    double fz = r.z - floor(r.z);
+    double fZ = 1 - fz;
+
+    // trilinear interpolation, see Grid::interpolate
+    Vector3f b(0.);
+    b += get(ix, iy, iz) * fX * fY * fZ;
+    b += get(iX, iy, iz) * fx * fY * fZ;
+    b += get(ix, iY, iz) * fX * fy * fZ;
+    b += get(ix, iy, iZ) * fX * fY * fz;
+    b += get(iX, iy, iZ) * fx * fY * fz;
+    b += get(ix, iY, iZ) * fX * fy * fz;
+    b += get(iX, iY, iz) * fx * fy * fZ;
+    b += get(iX, iY, iZ) * fx * fy * fz;
+    return b;
+}
+
+double CompressedVectorGrid::rmsError(ref_ptr<VectorGrid> grid) const {
+    if ((grid->getNx() != Nx) or (grid->getNy() != Ny) or (grid->getNz() != Nz))
+        throw std::runtime_error("CompressedVectorGrid: grid size does not match");
+    double sum = 0;
+    for (size_t ix = 0; ix < Nx; ix++)
+        for (size_t iy = 0; iy < Ny; iy++)
+            for (size_t iz = 0; iz < Nz; iz++)
+                sum += (get(ix, iy, iz) - grid->get(ix, iy, iz)).getR2();
+    return std::sqrt(sum / Nx / Ny / Nz);
+}
+
+double CompressedVectorGrid::maxError(ref_ptr<VectorGrid> grid) const {
+    if ((grid->getNx() != Nx) or (grid->getNy() != Ny) or (grid->getNz() != Nz))
+        throw std::runtime_error("CompressedVectorGrid: grid size does not match");
+    double error = 0;
+    for (size_t ix = 0; ix < Nx; ix++)
+        for (size_t iy = 0; iy < Ny; iy++)
+            for (size_t iz = 0; iz < Nz; iz++)
+                error = std::max(error, double((get(ix, iy, iz) - grid->get(ix, iy, iz)).getR()));
+    return error;
+}
+
+void CompressedVectorGrid::setReflective(bool b) {
+    reflective = b;
+}
+
+bool CompressedVectorGrid::isReflective() const {
+    return reflective;
+}
+
+Vector3d CompressedVectorGrid::getOrigin() const {
+    return origin;
+}
+
+size_t CompressedVectorGrid::getNx() const {
+    return Nx;
+}
+
+size_t CompressedVectorGrid::getNy() const {
+    return Ny;
+}
+
+size_t CompressedVectorGrid::getNz() const {
+    return Nz;
+}
+
+double CompressedVectorGrid::getSpacing() const {
+    return spacing;
+}
+
+size_t CompressedVectorGrid::getBrickSize() const {
+    return size_t(1) << brickBits;
+}
+
+CompressedVectorGrid::Encoding CompressedVectorGrid::getEncoding() const {
+    return encoding;
+}
+
+size_t CompressedVectorGrid::getMemorySize() const {
+    return data.size() + scales.size() * sizeof(float);
+}
+
+size_t CompressedVectorGrid::getBytesPerValue(Encoding encoding) {
+    switch (encoding) {
+    case Half:
+    case Int16:
+        return 2;
+    case Int8:
+        return 1;
+    default:
+        throw std::runtime_error("CompressedVectorGrid: unknown encoding");
+    }
+}
+
+float CompressedVectorGrid::encodeValues(Encoding encoding, const float *values, size_t n, unsigned char *data) {
+    float scale = 0;
+    for (size_t i = 0; i < n; i++)
+        scale = std::max(scale, std::abs(values[i]));
+    float inverse = (scale > 0) ? 1 / scale : 0;
+
+    for (size_t i = 0; i < n; i++) {
+        float c = values[i] * inverse;
+        if (encoding == Half) {
+            unsigned short h = floatToHalf(c);
+            memcpy(&data[i * 2], &h, 2);
+        } else if (encoding == Int16) {
+            short q = short(round(c * 32767));
+            memcpy(&data[i * 2], &q, 2);
+        } else {
+            signed char q = (signed char) round(c * 127);
+            data[i] = (unsigned char) q;
+        }
+    }
+    return scale;
+}
+
+void CompressedVectorGrid::decodeValues(Encoding encoding, const unsigned char *data, float scale, size_t n, float *values) {
+    for (size_t i = 0; i < n; i++) {
+        if (encoding == Half) {
+            unsigned short h;
+            memcpy(&h, &data[i * 2], 2);
+            values[i] = halfToFloat(h) * scale;
+        } else if (encoding == Int16) {
+            short q;
+            memcpy(&q, &data[i * 2], 2);
+            values[i] = q * (scale / 32767);
+        } else {
+            values[i] = (signed char) data[i] * (scale / 127);
+        }
+    }
+}
+
+} // namespace grpropa
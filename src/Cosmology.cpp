@@ -5,6 +5,7 @@
 #include <vector>
 #include <math.h>
 #include <stdexcept>
+#include <algorithm>
 
 namespace grpropa {
 /**
@@ -146,6 +147,16 @@ double redshift2LightTravelDistance(double z) {
     return interpolate(z, cosmology.Z, cosmology.Dt);
 }
 
+double redshiftAfterComovingDistance(double z, double d) {
+    double dz = hubbleRate(z) / c_light * d;
+    if (dz > 0.01) {
+        double dc = redshift2ComovingDistance(z) - d;
+        return (dc > 0) ? comovingDistance2Redshift(dc) : 0;
+    }
+    double dHdz = 1.5 * cosmology.omegaM * pow(1 + z, 2) * pow(cosmology.H0, 2) / hubbleRate(z);
+    return std::max(z - dz + 0.5 * dHdz / hubbleRate(z) * dz * dz, 0.);
+}
+
 double comoving2LightTravelDistance(double d) {
     if (d < 0)
         throw std::runtime_error("Cosmology: d < 0");
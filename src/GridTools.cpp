@@ -7,6 +7,17 @@
 #include <sstream>
 #include <iostream>
 #include <iomanip>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace grpropa {
 
@@ -24,6 +35,49 @@ void scaleGrid(ref_ptr<VectorGrid> grid, double a) {
                 grid->get(ix, iy, iz) *= a;
 }
 
+double bakeMagneticField(ref_ptr<VectorGrid> grid, ref_ptr<MagneticField> field, size_t nValidation, int seed) {
+    int Nx = grid->getNx();
+    int Ny = grid->getNy();
+    int Nz = grid->getNz();
+    double spacing = grid->getSpacing();
+    Vector3d gridOrigin = grid->getOrigin() + Vector3d(spacing / 2);
+
+    // rows along z are evaluated with one call of getFields
+#pragma omp parallel
+    {
+        std::vector<double> x(Nz), y(Nz), z(Nz), bx(Nz), by(Nz), bz(Nz);
+        for (int iz = 0; iz < Nz; iz++)
+            z[iz] = gridOrigin.z + iz * spacing;
+#pragma omp for schedule(dynamic)
+        for (int ix = 0; ix < Nx; ix++)
+            for (int iy = 0; iy < Ny; iy++) {
+                std::fill(x.begin(), x.end(), gridOrigin.x + ix * spacing);
+                std::fill(y.begin(), y.end(), gridOrigin.y + iy * spacing);
+                field->getFields(&x[0], &y[0], &z[0], &bx[0], &by[0], &bz[0], Nz);
+                for (int iz = 0; iz < Nz; iz++)
+                    grid->get(ix, iy, iz) = Vector3f(bx[iz], by[iz], bz[iz]);
+            }
+    }
+
+    // validation positions are drawn beforehand, so that they do not depend on the number of threads
+    Random random;
+    if (seed != 0)
+        random.seed(seed);
+    Vector3d extent = Vector3d(Nx - 1, Ny - 1, Nz - 1) * spacing;
+    std::vector<Vector3d> positions(nValidation);
+    for (size_t i = 0; i < nValidation; i++)
+        positions[i] = gridOrigin + Vector3d(random.rand(), random.rand(), random.rand()) * extent;
+
+    double sumDiff2 = 0, sumB2 = 0;
+#pragma omp parallel for reduction(+:sumDiff2,sumB2)
+    for (int i = 0; i < int(nValidation); i++) {
+        Vector3d b = field->getField(positions[i]);
+        sumDiff2 += (Vector3d(grid->interpolate(positions[i])) - b).getR2();
+        sumB2 += b.getR2();
+    }
+    return (sumB2 > 0) ? std::sqrt(sumDiff2 / sumB2) : 0;
+}
+
 Vector3f meanFieldVector(ref_ptr<VectorGrid> grid) {
     size_t Nx = grid->getNx();
     size_t Ny = grid->getNy();
@@ -32,7 +86,7 @@ Vector3f meanFieldVector(ref_ptr<VectorGrid> grid) {
     for (int ix = 0; ix < Nx; ix++)
         for (int iy = 0; iy < Ny; iy++)
             for (int iz = 0; iz < Nz; iz++)
-                mean += grid->get(ix, iy, iz);
+                mean += grid->getValue(ix, iy, iz);
     return mean / Nx / Ny / Nz;
 }
 
@@ -44,7 +98,7 @@ double meanFieldStrength(ref_ptr<VectorGrid> grid) {
     for (int ix = 0; ix < Nx; ix++)
         for (int iy = 0; iy < Ny; iy++)
             for (int iz = 0; iz < Nz; iz++)
-                mean += grid->get(ix, iy, iz).getR();
+                mean += grid->getValue(ix, iy, iz).getR();
     return mean / Nx / Ny / Nz;
 }
 
@@ -56,7 +110,7 @@ double meanFieldStrength(ref_ptr<ScalarGrid> grid) {
     for (int ix = 0; ix < Nx; ix++)
         for (int iy = 0; iy < Ny; iy++)
             for (int iz = 0; iz < Nz; iz++)
-                mean += grid->get(ix, iy, iz);
+                mean += grid->getValue(ix, iy, iz);
     return mean / Nx / Ny / Nz;
 }
 
@@ -68,7 +122,7 @@ double rmsFieldStrength(ref_ptr<VectorGrid> grid) {
     for (int ix = 0; ix < Nx; ix++)
         for (int iy = 0; iy < Ny; iy++)
             for (int iz = 0; iz < Nz; iz++)
-                sumV2 += grid->get(ix, iy, iz).getR2();
+                sumV2 += grid->getValue(ix, iy, iz).getR2();
     return std::sqrt(sumV2 / Nx / Ny / Nz);
 }
 
@@ -80,188 +134,199 @@ double rmsFieldStrength(ref_ptr<ScalarGrid> grid) {
     for (int ix = 0; ix < Nx; ix++)
         for (int iy = 0; iy < Ny; iy++)
             for (int iz = 0; iz < Nz; iz++)
-                sumV2 += pow(grid->get(ix, iy, iz), 2);
+                sumV2 += pow(grid->getValue(ix, iy, iz), 2);
     return std::sqrt(sumV2 / Nx / Ny / Nz);
 }
 
 #ifdef GRPROPA_HAVE_FFTW3F
 #include "fftw3.h"
+
+static std::string turbulenceWisdomFile;
+
+void setTurbulenceWisdomFile(std::string filename) {
+    turbulenceWisdomFile = filename;
+}
+
+static float vectorComponent(const Vector3f &v, int component) {
+    return (component == 0) ? v.x : ((component == 1) ? v.y : v.z);
+}
+
+// Fill one x-slab of the k-space with one vector component of the turbulent field.
+// The random numbers of a slab only depend on the seed and the slab, so all components of a mode are consistent.
+static void fillTurbulenceSlab(fftwf_complex *Bk, int component, size_t ix, const std::vector<double> &Kx,
+        const std::vector<double> &Ky, const std::vector<double> &Kz, double kMin, double kMax, double alpha,
+        bool helicity, double H, Random::uint32 seed) {
+    size_t Ny = Ky.size();
+    size_t Nz2 = Kz.size();
+    Random::uint32 slabSeed[2] = { seed, Random::uint32(ix) };
+    Random random(slabSeed, 2);
+
+    Vector3f ek, e1, e2; // orthogonal base
+    Vector3f n0(1, 1, 1); // arbitrary vector to construct orthogonal base
+
+    for (size_t iy = 0; iy < Ny; iy++) {
+        for (size_t iz = 0; iz < Nz2; iz++) {
+            size_t i = (ix * Ny + iy) * Nz2 + iz;
+            ek.setXYZ(Kx[ix], Ky[iy], Kz[iz]);
+            double k = ek.getR();
+
+            // wave outside of turbulent range -> B(k) = 0
+            if ((k < kMin) || (k > kMax)) {
+                Bk[i][0] = 0;
+                Bk[i][1] = 0;
+                continue;
+            }
+
+            Vector3f BkRe, BkIm; // real and imaginary part of B(k)
+
+            // construct an orthogonal base ek, e1, e2
+            // (for helical fields together with the real transform the following convention
+            // must be used: e1(-k) = e1(k), e2(-k) = - e2(k)
+            if (helicity == true) {
+                if (ek.getAngleTo(n0) < 1e-3) { // ek parallel to (1,1,1)
+                    e1.setXYZ(-1, 1, 0);
+                    e2.setXYZ(1, 1, -2);
+                } else { // ek not parallel to (1,1,1)
+                    e1 = n0.cross(ek);
+                    e2 = ek.cross(e1);
+                }
+                e1 /= e1.getR();
+                e2 /= e2.getR();
+
+                double Bkprefactor = mu0_vacPerm / (4 * M_PI * pow(k, 3));
+                double Bktot = fabs(random.randNorm() * pow(k, alpha / 2));
+                double Bkplus  = Bkprefactor * sqrt((1 + H) / 2) * Bktot;
+                double Bkminus = Bkprefactor * sqrt((1 - H) / 2) * Bktot;
+                double thetaplus = 2 * M_PI * random.rand();
+                double thetaminus = 2 * M_PI * random.rand();
+                double ctp = cos(thetaplus);
+                double stp = sin(thetaplus);
+                double ctm = cos(thetaminus);
+                double stm = sin(thetaminus);
+
+                BkRe = (e1 * (Bkplus * ctp + Bkminus * ctm) + e2 * (-Bkplus * stp + Bkminus * stm)) / sqrt(2);
+                BkIm = (e1 * (Bkplus * stp + Bkminus * stm) + e2 * ( Bkplus * ctp - Bkminus * ctm)) / sqrt(2);
+
+            } else { // no helicity
+                if (ek.isParallelTo(n0, float(1e-3))) {
+                    // ek parallel to (1,1,1)
+                    e1.setXYZ(-1., 1., 0);
+                    e2.setXYZ(1., 1., -2.);
+                } else {
+                    // ek not parallel to (1,1,1)
+                    e1 = n0.cross(ek);
+                    e2 = ek.cross(e1);
+                }
+                e1 /= e1.getR();
+                e2 /= e2.getR();
+
+                // random orientation perpendicular to k
+                double theta = 2 * M_PI * random.rand();
+                Vector3f b = e1 * cos(theta) + e2 * sin(theta);
+
+                // normal distributed amplitude with mean = 0 and sigma = k^alpha/2
+                b *= random.randNorm() * pow(k, alpha / 2);
+
+                // uniform random phase
+                double phase = 2 * M_PI * random.rand();
+                BkRe = b * cos(phase);
+                BkIm = b * sin(phase);
+            } // non helical case
+
+            Bk[i][0] = vectorComponent(BkRe, component);
+            Bk[i][1] = vectorComponent(BkIm, component);
+        } // for iz
+    } // for iy
+}
+
 void initTurbulence(ref_ptr<VectorGrid> grid, double Brms, double lMin, double lMax, double alpha, int seed, bool helicity, double H) {
     size_t Nx = grid->getNx();
     size_t Ny = grid->getNy();
     size_t Nz = grid->getNz();
-    if ((Nx != Ny) or (Ny != Nz))
-        throw std::runtime_error("turbulentField: only cubic grid supported");
+    size_t Nmin = std::min(Nx, std::min(Ny, Nz));
 
     double spacing = grid->getSpacing();
     if (lMin < 2 * spacing)
         throw std::runtime_error("turbulentField: lMin < 2 * spacing");
     if (lMin >= lMax)
         throw std::runtime_error("turbulentField: lMin >= lMax");
-    if (lMax > Nx * spacing / 2)
+    if (lMax > Nmin * spacing / 2)
         throw std::runtime_error("turbulentField: lMax > size / 2");
 
-    size_t n = Nx; // size of array
-    size_t n2 = (size_t) floor(n / 2) + 1; // size array in z-direction in configuration space
+    size_t Nz2 = Nz / 2 + 1; // size of the complex array in z-direction
 
-    // arrays to hold the complex vector components of the B(k)-field
-    fftwf_complex *Bkx, *Bky, *Bkz;
-    Bkx = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * n * n * n2);
-    Bky = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * n * n * n2);
-    Bkz = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * n * n * n2);
-
-
-    Random random;
-    if (seed != 0)
-        random.seed(seed); // use given seed
-
-    // calculate the n possible discrete wave numbers
-    double K[n];
-    for (int i = 0; i < n; i++)
-        K[i] = (double) i / n - i / (n / 2);
-
-    // construct the field in configuration space
-    int i;
-    double k;
-    
-    // only used if there is a helicity
-    double Bktot, Bkplus, Bkminus, thetaplus, thetaminus;
-    
-    // parameters goes for non helical calculations
-    double theta, phase, cosPhase, sinPhase;
-    
+    // discrete wave numbers in units of 1 / spacing, the upper half are the negative ones
+    std::vector<double> Kx(Nx), Ky(Ny), Kz(Nz2);
+    for (size_t i = 0; i < Nx; i++)
+        Kx[i] = (double) i / Nx - (2 * i >= Nx);
+    for (size_t i = 0; i < Ny; i++)
+        Ky[i] = (double) i / Ny - (2 * i >= Ny);
+    for (size_t i = 0; i < Nz2; i++)
+        Kz[i] = (double) i / Nz - (2 * i >= Nz);
     double kMin = spacing / lMax;
     double kMax = spacing / lMin;
-    Vector3f b; // real b-field vector
-    Vector3f ek, e1, e2; // orthogonal base
-    Vector3f n0(1, 1, 1); // arbitrary vector to construct orthogonal base
 
-    for (size_t ix = 0; ix < n; ix++) {
-        for (size_t iy = 0; iy < n; iy++) {
-            for (size_t iz = 0; iz < n2; iz++) {
-
-                i = ix * n * n2 + iy * n2 + iz;
-                ek.setXYZ(K[ix], K[iy], K[iz]);
-                k = ek.getR();
-
-                // wave outside of turbulent range -> B(k) = 0
-                if ((k < kMin) || (k > kMax)) {
-                    Bkx[i][0] = 0;
-                    Bkx[i][1] = 0;
-                    Bky[i][0] = 0;
-                    Bky[i][1] = 0;
-                    Bkz[i][0] = 0;
-                    Bkz[i][1] = 0;
-                    continue;
-                }
+    // seed of the random number streams of all slabs
+    Random::uint32 baseSeed = seed;
+    if (seed == 0) {
+        Random random;
+        baseSeed = random.randInt();
+    }
 
-                // construct an orthogonal base ek, e1, e2
-                // (for helical fields together with the real transform the following convention
-                // must be used: e1(-k) = e1(k), e2(-k) = - e2(k)
-                if (helicity == true) {
-                    if (ek.getAngleTo(n0) < 1e-3) { // ek parallel to (1,1,1)
-                        e1.setXYZ(-1, 1, 0);
-                        e2.setXYZ(1, 1, -2);
-                    } else { // ek not parallel to (1,1,1)
-                        e1 = n0.cross(ek);
-                        e2 = ek.cross(e1);
-                    }
-                    e1 /= e1.getR();
-                    e2 /= e2.getR();
-
-
-                    double Bkprefactor = mu0_vacPerm / (4 * M_PI * pow(k, 3));
-                    Bktot = fabs(random.randNorm() * pow(k, alpha / 2));
-                    Bkplus  = Bkprefactor * sqrt((1 + H) / 2) * Bktot;
-                    Bkminus = Bkprefactor * sqrt((1 - H) / 2) * Bktot;
-                    thetaplus = 2 * M_PI * random.rand();
-                    thetaminus = 2 * M_PI * random.rand();
-                    double ctp = cos(thetaplus);
-                    double stp = sin(thetaplus);
-                    double ctm = cos(thetaminus);
-                    double stm = sin(thetaminus);
-
-                    Bkx[i][0] = ((Bkplus * ctp + Bkminus * ctm) * e1.x + (-Bkplus * stp + Bkminus * stm) * e2.x) / sqrt(2);
-                    Bkx[i][1] = ((Bkplus * stp + Bkminus * stm) * e1.x + ( Bkplus * ctp - Bkminus * ctm) * e2.x) / sqrt(2);
-                    Bky[i][0] = ((Bkplus * ctp + Bkminus * ctm) * e1.y + (-Bkplus * stp + Bkminus * stm) * e2.y) / sqrt(2);
-                    Bky[i][1] = ((Bkplus * stp + Bkminus * stm) * e1.y + ( Bkplus * ctp - Bkminus * ctm) * e2.y) / sqrt(2);
-                    Bkz[i][0] = ((Bkplus * ctp + Bkminus * ctm) * e1.z + (-Bkplus * stp + Bkminus * stm) * e2.z) / sqrt(2);
-                    Bkz[i][1] = ((Bkplus * stp + Bkminus * stm) * e1.z + ( Bkplus * ctp - Bkminus * ctm) * e2.z) / sqrt(2);
-                    
-                    Vector3f BkRe(Bkx[i][0], Bky[i][0], Bkz[i][0]);
-                    Vector3f BkIm(Bkx[i][1], Bky[i][1], Bkz[i][1]);
-
-                } else { // no helicity
-                    if (ek.isParallelTo(n0, float(1e-3))) {
-                        // ek parallel to (1,1,1)
-                        e1.setXYZ(-1., 1., 0);
-                        e2.setXYZ(1., 1., -2.);
-                    } else {
-                        // ek not parallel to (1,1,1)
-                        e1 = n0.cross(ek);
-                        e2 = ek.cross(e1);
-                    }
-                    e1 /= e1.getR();
-                    e2 /= e2.getR();
-
-                    // random orientation perpendicular to k
-                    theta = 2 * M_PI * random.rand();
-                    b = e1 * cos(theta) + e2 * sin(theta);
-
-                    // normal distributed amplitude with mean = 0 and sigma = k^alpha/2
-                    b *= random.randNorm() * pow(k, alpha / 2);
-
-                    // uniform random phase
-                    phase = 2 * M_PI * random.rand();
-                    cosPhase = cos(phase); // real part
-                    sinPhase = sin(phase); // imaginary part
-
-                    Bkx[i][0] = b.x * cosPhase;
-                    Bkx[i][1] = b.x * sinPhase;
-                    Bky[i][0] = b.y * cosPhase;
-                    Bky[i][1] = b.y * sinPhase;
-                    Bkz[i][0] = b.z * cosPhase;
-                    Bkz[i][1] = b.z * sinPhase;
-
-                } // non helical case
-            } // for iz
-        } // for iy
-    } // for ix
-
-
-    // in-place, complex to real, inverse Fourier transformation on each component
-    // note that the last elements of B(x) are unused now
-    float *Bx = (float*) Bkx;
-    fftwf_plan plan_x = fftwf_plan_dft_c2r_3d(n, n, n, Bkx, Bx, FFTW_ESTIMATE);
-    fftwf_execute(plan_x);
-    fftwf_destroy_plan(plan_x);
-
-    float *By = (float*) Bky;
-    fftwf_plan plan_y = fftwf_plan_dft_c2r_3d(n, n, n, Bky, By, FFTW_ESTIMATE);
-    fftwf_execute(plan_y);
-    fftwf_destroy_plan(plan_y);
-
-    float *Bz = (float*) Bkz;
-    fftwf_plan plan_z = fftwf_plan_dft_c2r_3d(n, n, n, Bkz, Bz, FFTW_ESTIMATE);
-    fftwf_execute(plan_z);
-    fftwf_destroy_plan(plan_z);
-
-    // save to grid
-    for (size_t ix = 0; ix < n; ix++) {
-        for (size_t iy = 0; iy < n; iy++) {
-            for (size_t iz = 0; iz < n; iz++) {
-                i = ix * n * 2 * n2 + iy * 2 * n2 + iz;
-                Vector3f &b = grid->get(ix, iy, iz);
-                b.x = Bx[i];
-                b.y = By[i];
-                b.z = Bz[i];
+    // one complex array, transformed in place for one vector component after the other
+    fftwf_complex *Bk = (fftwf_complex*) fftwf_malloc(sizeof(fftwf_complex) * Nx * Ny * Nz2);
+    if (Bk == NULL)
+        throw std::runtime_error("turbulentField: could not allocate memory");
+    float *B = (float*) Bk;
+
+#ifdef GRPROPA_HAVE_FFTW3F_THREADS
+    static bool fftwThreadsInitialized = false;
+#pragma omp critical(initTurbulence)
+    if (not fftwThreadsInitialized)
+        fftwThreadsInitialized = fftwf_init_threads();
+#ifdef _OPENMP
+    fftwf_plan_with_nthreads(omp_get_max_threads());
+#endif
+#endif
+
+    // plan before filling the array, since measuring overwrites it
+    unsigned int flags = FFTW_ESTIMATE;
+    if (not turbulenceWisdomFile.empty()) {
+        fftwf_import_wisdom_from_filename(turbulenceWisdomFile.c_str());
+        flags = FFTW_MEASURE;
+    }
+    fftwf_plan plan = fftwf_plan_dft_c2r_3d(Nx, Ny, Nz, Bk, B, flags);
+    if (not turbulenceWisdomFile.empty())
+        fftwf_export_wisdom_to_filename(turbulenceWisdomFile.c_str());
+
+    for (int c = 0; c < 3; c++) {
+#pragma omp parallel for schedule(dynamic)
+        for (int ix = 0; ix < Nx; ix++)
+            fillTurbulenceSlab(Bk, c, ix, Kx, Ky, Kz, kMin, kMax, alpha, helicity, H, baseSeed);
+
+        // complex to real, inverse Fourier transformation
+        fftwf_execute(plan);
+
+        // save to grid, the rows of B(x) are padded to 2 * Nz2
+#pragma omp parallel for
+        for (int ix = 0; ix < Nx; ix++) {
+            for (size_t iy = 0; iy < Ny; iy++) {
+                for (size_t iz = 0; iz < Nz; iz++) {
+                    Vector3f &b = grid->get(ix, iy, iz);
+                    float value = B[(ix * Ny + iy) * 2 * Nz2 + iz];
+                    if (c == 0)
+                        b.x = value;
+                    else if (c == 1)
+                        b.y = value;
+                    else
+                        b.z = value;
+                }
             }
         }
     }
 
-    fftwf_free(Bkx);
-    fftwf_free(Bky);
-    fftwf_free(Bkz);
+    fftwf_destroy_plan(plan);
+    fftwf_free(Bk);
 
     scaleGrid(grid, Brms / rmsFieldStrength(grid)); // normalize to Brms
 }
@@ -340,6 +405,56 @@ void loadGrid(ref_ptr<ScalarGrid> grid, std::string filename, double c) {
     fin.close();
 }
 
+void loadGrid(ref_ptr<CompressedVectorGrid> grid, std::string filename, double c) {
+    std::ifstream fin(filename.c_str(), std::ios::binary);
+    if (!fin) {
+        std::stringstream ss;
+        ss << "load CompressedVectorGrid: " << filename << " not found";
+        throw std::runtime_error(ss.str());
+    }
+
+    // get length of file and compare to size of grid
+    fin.seekg(0, fin.end);
+    size_t length = fin.tellg() / sizeof(float);
+    fin.seekg (0, fin.beg);
+
+    size_t nx = grid->getNx();
+    size_t ny = grid->getNy();
+    size_t nz = grid->getNz();
+
+    if (length != (3 * nx * ny * nz))
+        throw std::runtime_error("loadGrid: file and grid size do not match");
+
+    // read one slab of B x-planes at a time and encode its bricks
+    size_t B = grid->getBrickSize();
+    std::vector<Vector3f> slab(B * ny * nz);
+    std::vector<Vector3f> brick(B * B * B);
+    for (size_t bx = 0; bx * B < nx; bx++) {
+        size_t nPlanes = std::min(B, nx - bx * B);
+        for (size_t i = 0; i < nPlanes * ny * nz; i++) {
+            Vector3f &b = slab[i];
+            fin.read((char*) &(b.x), sizeof(float));
+            fin.read((char*) &(b.y), sizeof(float));
+            fin.read((char*) &(b.z), sizeof(float));
+            b *= c;
+        }
+        for (size_t by = 0; by * B < ny; by++) {
+            for (size_t bz = 0; bz * B < nz; bz++) {
+                for (size_t i = 0; i < B; i++)
+                    for (size_t j = 0; j < B; j++)
+                        for (size_t k = 0; k < B; k++) {
+                            size_t iy = by * B + j;
+                            size_t iz = bz * B + k;
+                            if ((i < nPlanes) and (iy < ny) and (iz < nz))
+                                brick[(i * B + j) * B + k] = slab[(i * ny + iy) * nz + iz];
+                        }
+                grid->encodeBrick(bx, by, bz, &brick[0]);
+            }
+        }
+    }
+    fin.close();
+}
+
 void dumpGrid(ref_ptr<VectorGrid> grid, std::string filename, double c) {
     std::ofstream fout(filename.c_str(), std::ios::binary);
     if (!fout) {
@@ -347,6 +462,26 @@ void dumpGrid(ref_ptr<VectorGrid> grid, std::string filename, double c) {
         ss << "dump VectorGrid: " << filename << " not found";
         throw std::runtime_error(ss.str());
     }
+    for (int ix = 0; ix < grid->getNx(); ix++) {
+        for (int iy = 0; iy < grid->getNy(); iy++) {
+            for (int iz = 0; iz < grid->getNz(); iz++) {
+                Vector3f b = grid->getValue(ix, iy, iz) * c;
+                fout.write((char*) &(b.x), sizeof(float));
+                fout.write((char*) &(b.y), sizeof(float));
+                fout.write((char*) &(b.z), sizeof(float));
+            }
+        }
+    }
+    fout.close();
+}
+
+void dumpGrid(ref_ptr<CompressedVectorGrid> grid, std::string filename, double c) {
+    std::ofstream fout(filename.c_str(), std::ios::binary);
+    if (!fout) {
+        std::stringstream ss;
+        ss << "dump CompressedVectorGrid: " << filename << " not found";
+        throw std::runtime_error(ss.str());
+    }
     for (int ix = 0; ix < grid->getNx(); ix++) {
         for (int iy = 0; iy < grid->getNy(); iy++) {
             for (int iz = 0; iz < grid->getNz(); iz++) {
@@ -370,7 +505,7 @@ void dumpGrid(ref_ptr<ScalarGrid> grid, std::string filename, double c) {
     for (int ix = 0; ix < grid->getNx(); ix++) {
         for (int iy = 0; iy < grid->getNy(); iy++) {
             for (int iz = 0; iz < grid->getNz(); iz++) {
-                float b = grid->get(ix, iy, iz) * c;
+                float b = grid->getValue(ix, iy, iz) * c;
                 fout.write((char*) &b, sizeof(float));
             }
         }
@@ -378,6 +513,137 @@ void dumpGrid(ref_ptr<ScalarGrid> grid, std::string filename, double c) {
     fout.close();
 }
 
+// header of self-describing grid files
+struct GridFileHeader {
+    char magic[8]; // "GRPGRID"
+    unsigned int version;
+    unsigned int components; // 1 for scalar grids, 3 for vector grids, single precision
+    unsigned int brickSize;
+    unsigned int reflective;
+    unsigned long long Nx, Ny, Nz;
+    double origin[3];
+    double spacing;
+    unsigned long long dataOffset; // position of the values in bytes
+    unsigned long long dataSize; // size of the values in bytes
+};
+
+static const char gridFileMagic[8] = "GRPGRID";
+static const size_t gridFileAlignment = 4096;
+
+template<typename T>
+static void saveGridFile(const Grid<T> &grid, std::string filename, unsigned int components) {
+    std::ofstream fout(filename.c_str(), std::ios::binary);
+    if (!fout) {
+        std::stringstream ss;
+        ss << "saveGrid: " << filename << " could not be opened";
+        throw std::runtime_error(ss.str());
+    }
+
+    GridFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, gridFileMagic, sizeof(header.magic));
+    header.version = 1;
+    header.components = components;
+    header.brickSize = grid.getBrickSize();
+    header.reflective = grid.isReflective();
+    header.Nx = grid.getNx();
+    header.Ny = grid.getNy();
+    header.Nz = grid.getNz();
+    Vector3d origin = grid.getOrigin();
+    header.origin[0] = origin.x;
+    header.origin[1] = origin.y;
+    header.origin[2] = origin.z;
+    header.spacing = grid.getSpacing();
+    header.dataOffset = gridFileAlignment;
+    header.dataSize = grid.getStorageSize() * sizeof(T);
+
+    std::vector<char> padding(gridFileAlignment - sizeof(header), 0);
+    fout.write((char*) &header, sizeof(header));
+    fout.write(&padding[0], padding.size());
+    if (header.dataSize > 0)
+        fout.write((const char*) grid.getStorage(), header.dataSize);
+    if (!fout)
+        throw std::runtime_error("saveGrid: could not write " + filename);
+    fout.close();
+}
+
+void saveGrid(ref_ptr<VectorGrid> grid, std::string filename) {
+    saveGridFile(*grid, filename, 3);
+}
+
+void saveGrid(ref_ptr<ScalarGrid> grid, std::string filename) {
+    saveGridFile(*grid, filename, 1);
+}
+
+// memory mapping of a grid file, unmapped when the last grid using it is deleted
+class MappedGridFile: public Referenced {
+public:
+    void *address;
+    size_t length;
+    GridFileHeader header;
+
+    MappedGridFile(std::string filename) : address(MAP_FAILED), length(0) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("mapGrid: " + filename + " not found");
+        struct stat st;
+        if ((fstat(fd, &st) != 0) or (size_t(st.st_size) < sizeof(header))) {
+            close(fd);
+            throw std::runtime_error("mapGrid: " + filename + " is not a grid file");
+        }
+        length = st.st_size;
+        // read-only mapping: the pages are shared and not charged against the commit limit of the process
+        address = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (address == MAP_FAILED)
+            throw std::runtime_error("mapGrid: could not map " + filename);
+
+        memcpy(&header, address, sizeof(header));
+        std::string error;
+        if ((memcmp(header.magic, gridFileMagic, sizeof(header.magic)) != 0) or (header.version != 1))
+            error = " is not a grid file";
+        else if (header.dataOffset + header.dataSize > length)
+            error = " is truncated";
+        if (not error.empty()) {
+            munmap(address, length);
+            throw std::runtime_error("mapGrid: " + filename + error);
+        }
+    }
+
+    ~MappedGridFile() {
+        if (address != MAP_FAILED)
+            munmap(address, length);
+    }
+
+    template<typename T>
+    ref_ptr<Grid<T> > createGrid(unsigned int components) {
+        if (header.components != components) {
+            std::stringstream ss;
+            ss << "mapGrid: file has " << header.components << " components per grid point, expected " << components;
+            throw std::runtime_error(ss.str());
+        }
+        Vector3d origin(header.origin[0], header.origin[1], header.origin[2]);
+        // layout of an empty grid first, then the size and the values from the mapping
+        ref_ptr<Grid<T> > grid = new Grid<T>(origin, 0, 0, 0, header.spacing);
+        grid->setBrickSize(header.brickSize);
+        grid->setReflective(header.reflective);
+        grid->setStorage(header.Nx, header.Ny, header.Nz, (T *) ((char *) address + header.dataOffset), this);
+        if (grid->getStorageSize() * sizeof(T) != header.dataSize)
+            throw std::runtime_error("mapGrid: grid size and data size do not match");
+        return grid;
+    }
+};
+
+ref_ptr<VectorGrid> mapVectorGrid(std::string filename) {
+    ref_ptr<MappedGridFile> file = new MappedGridFile(filename);
+    return file->createGrid<Vector3f>(3);
+}
+
+ref_ptr<ScalarGrid> mapScalarGrid(std::string filename) {
+    ref_ptr<MappedGridFile> file = new MappedGridFile(filename);
+    return file->createGrid<float>(1);
+}
+
 void loadGridFromTxt(ref_ptr<VectorGrid> grid, std::string filename, double c) {
     std::ifstream fin(filename.c_str());
     if (!fin) {
@@ -438,7 +704,7 @@ void dumpGridToTxt(ref_ptr<VectorGrid> grid, std::string filename, double c) {
     for (int ix = 0; ix < grid->getNx(); ix++) {
         for (int iy = 0; iy < grid->getNy(); iy++) {
             for (int iz = 0; iz < grid->getNz(); iz++) {
-                Vector3f b = grid->get(ix, iy, iz) * c;
+                Vector3f b = grid->getValue(ix, iy, iz) * c;
                 fout << b << "\n";
             }
         }
@@ -456,7 +722,7 @@ void dumpGridToTxt(ref_ptr<ScalarGrid> grid, std::string filename, double c) {
     for (int ix = 0; ix < grid->getNx(); ix++) {
         for (int iy = 0; iy < grid->getNy(); iy++) {
             for (int iz = 0; iz < grid->getNz(); iz++) {
-                float b = grid->get(ix, iy, iz) * c;
+                float b = grid->getValue(ix, iy, iz) * c;
                 fout << b << "\n";
             }
         }
@@ -76,4 +76,8 @@ void AbstractCondition::setAcceptFlag(std::string key, std::string value) {
 	acceptFlagValue = value;
 }
 
+double AbstractCondition::distanceToRejection(const Vector3d &position, const Vector3d &direction) const {
+	return -1;
+}
+
 } // namespace grpropa
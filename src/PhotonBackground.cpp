@@ -1,8 +1,15 @@
 #include "grpropa/PhotonBackground.h"
 #include "grpropa/Common.h"
+#include "grpropa/Units.h"
 
-#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
 
 namespace grpropa {
 
@@ -19,6 +26,394 @@ void listOfPhotonBackgroundModels()
     std::cout << "      Finke+ '10" << std::endl;
     std::cout << "      Kneiske & Dole '10" << std::endl;
     std::cout << "      Franceschini+ '08" << std::endl;
+    std::cout << " - custom photon fields, see CustomPhotonField" << std::endl;
+}
+
+// CustomPhotonField ----------------------------------------------------------
+CustomPhotonField::CustomPhotonField() {
+}
+
+CustomPhotonField::CustomPhotonField(const std::vector<double> &photonEnergies, const std::vector<double> &redshifts, const std::vector<double> &density) {
+    setDensity(photonEnergies, redshifts, density);
+}
+
+void CustomPhotonField::setDensity(const std::vector<double> &photonEnergies, const std::vector<double> &redshifts, const std::vector<double> &density) {
+    if (photonEnergies.size() < 2)
+        throw std::runtime_error("CustomPhotonField: at least two photon energies needed");
+    if (redshifts.size() < 1)
+        throw std::runtime_error("CustomPhotonField: at least one redshift needed");
+    if (density.size() != photonEnergies.size() * redshifts.size())
+        throw std::runtime_error("CustomPhotonField: density does not match the number of photon energies and redshifts");
+    tabPhotonEnergy = photonEnergies;
+    tabRedshift = redshifts;
+    tabDensity = density;
+}
+
+void CustomPhotonField::loadFromTxt(std::string filename) {
+    std::ifstream infile(filename.c_str());
+    if (!infile.good())
+        throw std::runtime_error("CustomPhotonField: could not open file " + filename);
+
+    std::vector<double> energies, redshifts, columns;
+    std::string line;
+    while (std::getline(infile, line)) {
+        if ((line.size() == 0) or (line[0] == '#'))
+            continue;
+        std::stringstream ss(line);
+        double value;
+        if (redshifts.size() == 0) {
+            while (ss >> value)
+                redshifts.push_back(value);
+            continue;
+        }
+        ss >> value;
+        energies.push_back(value * eV);
+        for (size_t iz = 0; iz < redshifts.size(); iz++) {
+            if (!(ss >> value))
+                throw std::runtime_error("CustomPhotonField: missing density in " + filename);
+            columns.push_back(value / (centimeter * centimeter * centimeter * eV));
+        }
+    }
+    infile.close();
+
+    // reorder to one column per redshift
+    size_t ne = energies.size();
+    size_t nz = redshifts.size();
+    std::vector<double> density(ne * nz);
+    for (size_t ie = 0; ie < ne; ie++)
+        for (size_t iz = 0; iz < nz; iz++)
+            density[iz * ne + ie] = columns[ie * nz + iz];
+
+    setDensity(energies, redshifts, density);
+}
+
+double CustomPhotonField::getPhotonDensity(double eps, double z) const {
+    size_t ne = tabPhotonEnergy.size();
+    if ((eps < tabPhotonEnergy.front()) or (eps > tabPhotonEnergy.back()))
+        return 0;
+
+    size_t ie = std::upper_bound(tabPhotonEnergy.begin(), tabPhotonEnergy.end(), eps) - tabPhotonEnergy.begin();
+    ie = std::min(std::max(ie, size_t(1)), ne - 1) - 1;
+
+    // redshift neighbors and weight, clamped to the tabulated range
+    size_t iz = 0;
+    double fz = 0;
+    if (tabRedshift.size() > 1) {
+        if (z >= tabRedshift.back()) {
+            iz = tabRedshift.size() - 2;
+            fz = 1;
+        } else if (z > tabRedshift.front()) {
+            iz = std::upper_bound(tabRedshift.begin(), tabRedshift.end(), z) - tabRedshift.begin() - 1;
+            fz = (z - tabRedshift[iz]) / (tabRedshift[iz + 1] - tabRedshift[iz]);
+        }
+    }
+
+    double n[2];
+    for (size_t k = 0; k < 2; k++) {
+        size_t j = std::min(iz + k, tabRedshift.size() - 1);
+        double n0 = tabDensity[j * ne + ie];
+        double n1 = tabDensity[j * ne + ie + 1];
+        double e0 = tabPhotonEnergy[ie];
+        double e1 = tabPhotonEnergy[ie + 1];
+        if ((n0 > 0) and (n1 > 0))
+            n[k] = n0 * pow(n1 / n0, log(eps / e0) / log(e1 / e0)); // log-log interpolation
+        else
+            n[k] = n0 + (n1 - n0) * (eps - e0) / (e1 - e0);
+    }
+    return n[0] * (1 - fz) + n[1] * fz;
+}
+
+const std::vector<double> &CustomPhotonField::getPhotonEnergies() const {
+    return tabPhotonEnergy;
+}
+
+const std::vector<double> &CustomPhotonField::getRedshifts() const {
+    return tabRedshift;
+}
+
+// InteractionTables ----------------------------------------------------------
+void InteractionTables::dump(std::string rateFilename, std::string probabilityFilename) const {
+    std::ofstream rateFile(rateFilename.c_str());
+    if (!rateFile)
+        throw std::runtime_error("InteractionTables: could not open file " + rateFilename);
+    size_t ne = tabEnergy.size();
+    size_t nz = tabRedshift.size();
+    for (size_t ie = 0; ie < ne; ie++) {
+        rateFile << std::scientific << std::setprecision(3) << tabEnergy[ie] / eV;
+        for (size_t iz = 0; iz < nz; iz++)
+            rateFile << "\t" << std::setprecision(8) << tabRate[iz * ne + ie] * Mpc;
+        rateFile << "\n";
+    }
+    rateFile.close();
+
+    std::ofstream probFile(probabilityFilename.c_str());
+    if (!probFile)
+        throw std::runtime_error("InteractionTables: could not open file " + probabilityFilename);
+    size_t np = tabProb.size();
+    for (size_t ip = 0; ip < np; ip++) {
+        probFile << std::scientific << std::setprecision(6) << tabProb[ip];
+        for (size_t iz = 0; iz < nz; iz++)
+            probFile << "\t" << std::setprecision(6) << tabPhotonEnergy[iz * np + ip] / eV;
+        probFile << "\n";
+    }
+    probFile.close();
+}
+
+// Rate calculation -----------------------------------------------------------
+static const double ThomsonCrossSection = 6.6524587158e-29 * meter * meter;
+
+// Breit-Wheeler cross section for gamma gamma -> e+ e- at squared center of mass energy s
+TabulatedInteraction::TabulatedInteraction() :
+        redshiftDependence(false), nTableEnergies(0), nTableProbabilities(0), singlePrecision(false),
+        rateTableError(0), photonTableError(0), tableEnergyMin(0), tableEnergyMax(0), tableRateLast(0) {
+}
+
+void TabulatedInteraction::setInteractionTables(ref_ptr<InteractionTables> tables, const std::string &module) {
+    if ((tables->tabEnergy.size() < 2) or (tables->tabProb.size() < 2) or (tables->tabRedshift.size() < 1))
+        throw std::runtime_error(module + ": incomplete interaction tables");
+    if (tables->tabRate.size() != tables->tabEnergy.size() * tables->tabRedshift.size())
+        throw std::runtime_error(module + ": interaction rates do not match the tabulated energies and redshifts");
+    if (tables->tabPhotonEnergy.size() != tables->tabProb.size() * tables->tabRedshift.size())
+        throw std::runtime_error(module + ": background photon energies do not match the tabulated probabilities and redshifts");
+
+    redshiftDependence = (tables->tabRedshift.size() > 1);
+    tabEnergy = tables->tabEnergy;
+    tabRate = tables->tabRate;
+    tabProb = tables->tabProb;
+    tabPhotonEnergy = tables->tabPhotonEnergy;
+    tabRedshift.clear();
+    if (redshiftDependence)
+        tabRedshift = tables->tabRedshift;
+    customTables = tables;
+}
+
+static std::vector<double> logarithmicGrid(double lo, double hi, size_t n) {
+    std::vector<double> grid(n);
+    for (size_t i = 0; i < n; i++)
+        grid[i] = lo * pow(hi / lo, double(i) / (n - 1));
+    grid.back() = hi;
+    return grid;
+}
+
+void TabulatedInteraction::applyTableResolution() {
+    std::vector<double> energies = tabEnergy;
+    if (nTableEnergies > 1)
+        energies = logarithmicGrid(tabEnergy.front(), tabEnergy.back(), nTableEnergies);
+    std::vector<double> rates;
+    rateTableError = resampleTable(tabEnergy, tabRate, energies, rates, singlePrecision);
+    tabEnergy.swap(energies);
+    tabRate.swap(rates);
+
+    std::vector<double> probabilities = tabProb;
+    if ((nTableProbabilities > 1) and (tabProb.front() > 0))
+        probabilities = logarithmicGrid(tabProb.front(), tabProb.back(), nTableProbabilities);
+    std::vector<double> photonEnergies;
+    photonTableError = resampleTable(tabProb, tabPhotonEnergy, probabilities, photonEnergies, singlePrecision);
+    tabProb.swap(probabilities);
+    tabPhotonEnergy.swap(photonEnergies);
+
+    tableEnergyMin = tabEnergy.front();
+    tableEnergyMax = tabEnergy.back();
+    tableRateLast = tabRate.back();
+
+    if (singlePrecision) {
+        tabEnergyF.assign(tabEnergy.begin(), tabEnergy.end());
+        tabRateF.assign(tabRate.begin(), tabRate.end());
+        tabRedshiftF.assign(tabRedshift.begin(), tabRedshift.end());
+        tabPhotonEnergyF.assign(tabPhotonEnergy.begin(), tabPhotonEnergy.end());
+        tabProbF.assign(tabProb.begin(), tabProb.end());
+        // release the double precision tables
+        std::vector<double>().swap(tabEnergy);
+        std::vector<double>().swap(tabRate);
+        std::vector<double>().swap(tabRedshift);
+        std::vector<double>().swap(tabPhotonEnergy);
+        std::vector<double>().swap(tabProb);
+    } else {
+        std::vector<float>().swap(tabEnergyF);
+        std::vector<float>().swap(tabRateF);
+        std::vector<float>().swap(tabRedshiftF);
+        std::vector<float>().swap(tabPhotonEnergyF);
+        std::vector<float>().swap(tabProbF);
+    }
+}
+
+double TabulatedInteraction::rate(double E, double z) const {
+    if (singlePrecision) {
+        if (redshiftDependence)
+            return interpolate2d(z, E, tabRedshiftF, tabEnergyF, tabRateF);
+        return interpolate(E, tabEnergyF, tabRateF);
+    }
+    if (redshiftDependence)
+        return interpolate2d(z, E, tabRedshift, tabEnergy, tabRate);
+    return interpolate(E, tabEnergy, tabRate);
+}
+
+double TabulatedInteraction::photonEnergy(double p, double z) const {
+    if (singlePrecision) {
+        if (redshiftDependence)
+            return interpolate2d(z, p, tabRedshiftF, tabProbF, tabPhotonEnergyF);
+        return interpolate(p, tabProbF, tabPhotonEnergyF);
+    }
+    if (redshiftDependence)
+        return interpolate2d(z, p, tabRedshift, tabProb, tabPhotonEnergy);
+    return interpolate(p, tabProb, tabPhotonEnergy);
+}
+
+static double crossSectionPairProduction(double s) {
+    double m2 = pow(mass_electron * c_squared, 2);
+    if (s <= 4 * m2)
+        return 0;
+    double b = sqrt(1 - 4 * m2 / s);
+    return 3. / 16. * ThomsonCrossSection * (1 - b * b) * ((3 - pow(b, 4)) * log((1 + b) / (1 - b)) - 2 * b * (2 - b * b));
+}
+
+// Klein-Nishina cross section for e gamma -> e gamma at squared center of mass energy s
+static double crossSectionInverseCompton(double s) {
+    double m2 = pow(mass_electron * c_squared, 2);
+    double b = (s - m2) / (s + m2);
+    if (b < 1e-3)
+        return ThomsonCrossSection * (1 - 2 * b); // Thomson limit, avoids the cancellation below
+    double a = 2 / (b * (1 + b)) * (2 + 2 * b - b * b - 2 * b * b * b);
+    double c = (2 - 3 * b * b - b * b * b) / (b * b) * log((1 + b) / (1 - b));
+    return 3. / 8. * ThomsonCrossSection * m2 / (s * b) * (a - c);
+}
+
+/*
+ Tabulate Phi(t) = int_s0^(s0 + t) (s - weightOffset) * sigma(s) ds
+ on a logarithmic grid in t between tMin and tMax.
+ */
+static void tabulateCrossSectionIntegral(double (*sigma)(double), double s0, double weightOffset, double tMin, double tMax, std::vector<double> &Phi) {
+    size_t n = Phi.size();
+    double dlt = log(tMax / tMin) / (n - 1);
+    Phi[0] = 0;
+    double fPrev = (s0 + tMin - weightOffset) * sigma(s0 + tMin) * tMin;
+    for (size_t i = 1; i < n; i++) {
+        double t = tMin * exp(i * dlt);
+        double f = (s0 + t - weightOffset) * sigma(s0 + t) * t;
+        Phi[i] = Phi[i - 1] + (f + fPrev) / 2 * dlt;
+        fPrev = f;
+    }
+}
+
+static void tabulateBackgroundPhotons(const CustomPhotonField &field, InteractionTables &tables, size_t nProb) {
+    const std::vector<double> &eps = field.getPhotonEnergies();
+    const std::vector<double> &redshifts = field.getRedshifts();
+    size_t nz = redshifts.size();
+
+    tables.tabProb.resize(nProb);
+    for (size_t ip = 0; ip < nProb; ip++)
+        tables.tabProb[ip] = pow(10, -5 + 5. * ip / (nProb - 1));
+    tables.tabPhotonEnergy.resize(nz * nProb);
+
+    // cumulative distribution of n(eps) / eps, integrated in ln(eps)
+    const size_t nInt = 1000;
+    double dle = log(eps.back() / eps.front()) / (nInt - 1);
+    std::vector<double> grid(nInt);
+    for (size_t k = 0; k < nInt; k++)
+        grid[k] = eps.front() * exp(k * dle);
+
+    bool empty = false;
+#pragma omp parallel for reduction(||:empty)
+    for (int iz = 0; iz < (int) nz; iz++) {
+        std::vector<double> cdf(nInt, 0);
+        double nPrev = field.getPhotonDensity(grid[0], redshifts[iz]);
+        for (size_t k = 1; k < nInt; k++) {
+            double n = field.getPhotonDensity(grid[k], redshifts[iz]);
+            cdf[k] = cdf[k - 1] + (n + nPrev) / 2 * dle;
+            nPrev = n;
+        }
+        if (cdf.back() <= 0) {
+            empty = true;
+            continue;
+        }
+        for (size_t k = 0; k < nInt; k++)
+            cdf[k] /= cdf.back();
+        for (size_t ip = 0; ip < nProb; ip++)
+            tables.tabPhotonEnergy[iz * nProb + ip] = interpolate(tables.tabProb[ip], cdf, grid);
+    }
+    if (empty)
+        throw std::runtime_error("CustomPhotonField: no photons at one of the redshifts");
+}
+
+/*
+ Interaction rate R(E, z) = 1 / (8 E^2 beta) int deps n(eps, z) / eps^2 Phi(s(eps) - s0)
+ with s(eps) = sMin + 2 E eps (1 + beta), evaluated for all energies and redshifts of the tables.
+ */
+static void tabulateRates(const CustomPhotonField &field, InteractionTables &tables, double (*sigma)(double), double s0, double sMin, double weightOffset, double mass2, double epsThresholdFactor) {
+    const std::vector<double> &eps = field.getPhotonEnergies();
+    size_t ne = tables.tabEnergy.size();
+    size_t nz = tables.tabRedshift.size();
+
+    // cross section integral, covering all energies of the table
+    double tMax = 4 * tables.tabEnergy.back() * eps.back() * 1.1;
+    double tMin = 1e-10 * s0;
+    std::vector<double> Phi(4000);
+    tabulateCrossSectionIntegral(sigma, s0, weightOffset, tMin, tMax, Phi);
+    double ltMin = log(tMin);
+    double ltMax = log(tMax);
+
+    const size_t nInt = 400;
+    tables.tabRate.resize(ne * nz);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < (int) (ne * nz); i++) {
+        size_t iz = i / ne;
+        size_t ie = i % ne;
+        double E = tables.tabEnergy[ie];
+        double z = tables.tabRedshift[iz];
+        double beta = sqrt(1 - std::min(1., mass2 / (E * E)));
+
+        double lo = std::max(eps.front(), epsThresholdFactor / E);
+        double hi = eps.back();
+        if ((lo >= hi) or (beta <= 0)) {
+            tables.tabRate[i] = 0;
+            continue;
+        }
+
+        // trapezoidal integration in ln(eps)
+        double dle = log(hi / lo) / (nInt - 1);
+        double sum = 0;
+        for (size_t k = 0; k < nInt; k++) {
+            double e = lo * exp(k * dle);
+            double t = sMin + 2 * E * e * (1 + beta) - s0;
+            if (t <= tMin)
+                continue;
+            double f = field.getPhotonDensity(e, z) / e * interpolateEquidistant(log(t), ltMin, ltMax, Phi);
+            sum += ((k == 0) or (k == nInt - 1)) ? f / 2 : f;
+        }
+        tables.tabRate[i] = sum * dle / (8 * E * E * beta);
+    }
+}
+
+static ref_ptr<InteractionTables> initTables(const CustomPhotonField &field, size_t nEnergies, double Emin, double Emax, size_t nProb) {
+    if (field.getPhotonEnergies().size() < 2)
+        throw std::runtime_error("CustomPhotonField: no density set");
+    if ((nEnergies < 2) or (nProb < 2))
+        throw std::runtime_error("InteractionTables: at least two energies and probabilities needed");
+
+    ref_ptr<InteractionTables> tables = new InteractionTables;
+    tables->tabRedshift = field.getRedshifts();
+    tables->tabEnergy.resize(nEnergies);
+    for (size_t ie = 0; ie < nEnergies; ie++)
+        tables->tabEnergy[ie] = Emin * pow(Emax / Emin, double(ie) / (nEnergies - 1));
+    tabulateBackgroundPhotons(field, *tables, nProb);
+    return tables;
+}
+
+ref_ptr<InteractionTables> pairProductionTables(ref_ptr<CustomPhotonField> field, size_t nEnergies, double Emin, double Emax, size_t nProb) {
+    ref_ptr<InteractionTables> tables = initTables(*field, nEnergies, Emin, Emax, nProb);
+    // photons: s = 2 E eps (1 - cos) with a maximum of 4 E eps, threshold at s = 4 m^2
+    double m2 = pow(mass_electron * c_squared, 2);
+    tabulateRates(*field, *tables, crossSectionPairProduction, 4 * m2, 0, 0, 0, m2);
+    return tables;
+}
+
+ref_ptr<InteractionTables> inverseComptonTables(ref_ptr<CustomPhotonField> field, size_t nEnergies, double Emin, double Emax, size_t nProb) {
+    ref_ptr<InteractionTables> tables = initTables(*field, nEnergies, Emin, Emax, nProb);
+    // electrons: s = m^2 + 2 E eps (1 - beta cos) with a maximum of m^2 + 2 E eps (1 + beta)
+    double m2 = pow(mass_electron * c_squared, 2);
+    tabulateRates(*field, *tables, crossSectionInverseCompton, m2, m2, m2, m2, 0);
+    return tables;
 }
 
 } // namespace grpropa
@@ -258,6 +258,8 @@ void SourceUniform1D::setDescription() {
 // ----------------------------------------------------------------------------
 SourceDensityGrid::SourceDensityGrid(ref_ptr<ScalarGrid> grid) :
         grid(grid) {
+    // the cumulative distribution is sampled from the storage vector, which needs the linear layout
+    grid->setBrickSize(1);
     float sum = 0;
     for (int ix = 0; ix < grid->getNx(); ix++) {
         for (int iy = 0; iy < grid->getNy(); iy++) {
@@ -298,6 +300,7 @@ SourceDensityGrid1D::SourceDensityGrid1D(ref_ptr<ScalarGrid> grid) :
     if (grid->getNz() != 1)
         throw std::runtime_error("SourceDensityGrid1D: Nz != 1");
 
+    grid->setBrickSize(1);
     float sum = 0;
     for (int ix = 0; ix < grid->getNx(); ix++) {
         sum += grid->get(ix, 0, 0);
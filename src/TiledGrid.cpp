@@ -0,0 +1,408 @@
+#include "grpropa/TiledGrid.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace grpropa {
+
+// header of tile files, followed by the tiles and then the scale factors of all tiles
+struct TiledGridFileHeader {
+    char magic[8]; // "GRPTILE"
+    unsigned int version;
+    unsigned int encoding;
+    unsigned int tileSize;
+    unsigned int reserved;
+    unsigned long long Nx, Ny, Nz;
+    double origin[3];
+    double spacing;
+    unsigned long long dataOffset; // position of the first tile in bytes
+    unsigned long long scalesOffset; // position of the scale factors in bytes
+};
+
+static const char tiledGridMagic[8] = "GRPTILE";
+
+static size_t log2Size(size_t size) {
+    size_t bits = 0;
+    while ((size_t(1) << bits) < size)
+        bits++;
+    if ((size_t(1) << bits) != size)
+        throw std::runtime_error("TiledVectorGrid: tile size must be a power of 2");
+    return bits;
+}
+
+// encode and write the tiles of one slab of tileSize x-planes, with the z-index changing the fastest
+static void writeTiles(std::ofstream &fout, const std::vector<Vector3f> &slab, size_t nPlanes, size_t Ny,
+        size_t Nz, size_t T, CompressedVectorGrid::Encoding encoding, std::vector<float> &scales) {
+    std::vector<float> values(3 * T * T * T);
+    std::vector<unsigned char> data(values.size() * CompressedVectorGrid::getBytesPerValue(encoding));
+    for (size_t ty = 0; ty * T < Ny; ty++) {
+        for (size_t tz = 0; tz * T < Nz; tz++) {
+            size_t n = 0;
+            for (size_t i = 0; i < T; i++)
+                for (size_t j = 0; j < T; j++)
+                    for (size_t k = 0; k < T; k++) {
+                        size_t iy = ty * T + j;
+                        size_t iz = tz * T + k;
+                        Vector3f b(0.);
+                        if ((i < nPlanes) and (iy < Ny) and (iz < Nz))
+                            b = slab[(i * Ny + iy) * Nz + iz];
+                        values[n++] = b.x;
+                        values[n++] = b.y;
+                        values[n++] = b.z;
+                    }
+            scales.push_back(CompressedVectorGrid::encodeValues(encoding, &values[0], values.size(), &data[0]));
+            fout.write((char*) &data[0], data.size());
+        }
+    }
+}
+
+static void writeHeader(std::ofstream &fout, Vector3d origin, size_t Nx, size_t Ny, size_t Nz, double spacing,
+        CompressedVectorGrid::Encoding encoding, size_t tileSize, unsigned long long scalesOffset) {
+    TiledGridFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, tiledGridMagic, sizeof(header.magic));
+    header.version = 1;
+    header.encoding = encoding;
+    header.tileSize = tileSize;
+    header.Nx = Nx;
+    header.Ny = Ny;
+    header.Nz = Nz;
+    header.origin[0] = origin.x;
+    header.origin[1] = origin.y;
+    header.origin[2] = origin.z;
+    header.spacing = spacing;
+    header.dataOffset = sizeof(header);
+    header.scalesOffset = scalesOffset;
+    fout.seekp(0, fout.beg);
+    fout.write((char*) &header, sizeof(header));
+}
+
+void TiledVectorGrid::create(std::string filename, ref_ptr<VectorGrid> grid,
+        CompressedVectorGrid::Encoding encoding, size_t T) {
+    log2Size(T);
+    std::ofstream fout(filename.c_str(), std::ios::binary);
+    if (!fout)
+        throw std::runtime_error("TiledVectorGrid: could not open " + filename);
+
+    size_t Nx = grid->getNx(), Ny = grid->getNy(), Nz = grid->getNz();
+    writeHeader(fout, grid->getOrigin(), Nx, Ny, Nz, grid->getSpacing(), encoding, T, 0);
+    std::vector<float> scales;
+    std::vector<Vector3f> slab(T * Ny * Nz);
+    for (size_t tx = 0; tx * T < Nx; tx++) {
+        size_t nPlanes = std::min(T, Nx - tx * T);
+        for (size_t i = 0; i < nPlanes; i++)
+            for (size_t iy = 0; iy < Ny; iy++)
+                for (size_t iz = 0; iz < Nz; iz++)
+                    slab[(i * Ny + iy) * Nz + iz] = grid->get(tx * T + i, iy, iz);
+        writeTiles(fout, slab, nPlanes, Ny, Nz, T, encoding, scales);
+    }
+
+    unsigned long long scalesOffset = fout.tellp();
+    fout.write((char*) &scales[0], scales.size() * sizeof(float));
+    writeHeader(fout, grid->getOrigin(), Nx, Ny, Nz, grid->getSpacing(), encoding, T, scalesOffset);
+    if (!fout)
+        throw std::runtime_error("TiledVectorGrid: could not write " + filename);
+}
+
+void TiledVectorGrid::convert(std::string gridFile, std::string filename, Vector3d origin, size_t Nx, size_t Ny,
+        size_t Nz, double spacing, CompressedVectorGrid::Encoding encoding, size_t T, double c) {
+    log2Size(T);
+    std::ifstream fin(gridFile.c_str(), std::ios::binary);
+    if (!fin) {
+        std::stringstream ss;
+        ss << "TiledVectorGrid: " << gridFile << " not found";
+        throw std::runtime_error(ss.str());
+    }
+    fin.seekg(0, fin.end);
+    size_t length = fin.tellg() / sizeof(float);
+    fin.seekg(0, fin.beg);
+    if (length != (3 * Nx * Ny * Nz))
+        throw std::runtime_error("TiledVectorGrid: file and grid size do not match");
+
+    std::ofstream fout(filename.c_str(), std::ios::binary);
+    if (!fout)
+        throw std::runtime_error("TiledVectorGrid: could not open " + filename);
+
+    writeHeader(fout, origin, Nx, Ny, Nz, spacing, encoding, T, 0);
+    std::vector<float> scales;
+    std::vector<Vector3f> slab(T * Ny * Nz);
+    for (size_t tx = 0; tx * T < Nx; tx++) {
+        size_t nPlanes = std::min(T, Nx - tx * T);
+        for (size_t i = 0; i < nPlanes * Ny * Nz; i++) {
+            Vector3f &b = slab[i];
+            fin.read((char*) &(b.x), sizeof(float));
+            fin.read((char*) &(b.y), sizeof(float));
+            fin.read((char*) &(b.z), sizeof(float));
+            b *= c;
+        }
+        writeTiles(fout, slab, nPlanes, Ny, Nz, T, encoding, scales);
+    }
+
+    unsigned long long scalesOffset = fout.tellp();
+    fout.write((char*) &scales[0], scales.size() * sizeof(float));
+    writeHeader(fout, origin, Nx, Ny, Nz, spacing, encoding, T, scalesOffset);
+    if (!fout)
+        throw std::runtime_error("TiledVectorGrid: could not write " + filename);
+}
+
+TiledVectorGrid::TiledVectorGrid(std::string filename, size_t cacheSize) :
+        filename(filename), reflective(false), misses(0) {
+    if (cacheSize == 0)
+        throw std::runtime_error("TiledVectorGrid: cache size must be positive");
+
+    fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("TiledVectorGrid: " + filename + " not found");
+
+    TiledGridFileHeader header;
+    if ((pread(fd, &header, sizeof(header), 0) != sizeof(header))
+            or (memcmp(header.magic, tiledGridMagic, sizeof(header.magic)) != 0) or (header.version != 1)
+            or (header.encoding > CompressedVectorGrid::Int8) or (header.tileSize == 0)
+            or (header.tileSize & (header.tileSize - 1))) {
+        close(fd);
+        throw std::runtime_error("TiledVectorGrid: " + filename + " is not a tile file");
+    }
+
+    encoding = CompressedVectorGrid::Encoding(header.encoding);
+    Nx = header.Nx;
+    Ny = header.Ny;
+    Nz = header.Nz;
+    origin = Vector3d(header.origin[0], header.origin[1], header.origin[2]);
+    spacing = header.spacing;
+    gridOrigin = origin + Vector3d(spacing / 2);
+    dataOffset = header.dataOffset;
+    tileBits = log2Size(header.tileSize);
+    size_t T = header.tileSize;
+    NTx = (Nx + T - 1) >> tileBits;
+    NTy = (Ny + T - 1) >> tileBits;
+    NTz = (Nz + T - 1) >> tileBits;
+    tileBytes = 3 * T * T * T * CompressedVectorGrid::getBytesPerValue(encoding);
+
+    size_t nTiles = NTx * NTy * NTz;
+    scales.resize(nTiles);
+    ssize_t n = nTiles * sizeof(float);
+    if (pread(fd, &scales[0], n, header.scalesOffset) != n) {
+        close(fd);
+        throw std::runtime_error("TiledVectorGrid: " + filename + " is truncated");
+    }
+
+    slotOfTile.assign(nTiles, -1);
+    slots.resize(std::min(cacheSize, nTiles));
+    for (size_t i = 0; i < slots.size(); i++) {
+        slots[i].tile = nTiles;
+        slots[i].version = 0;
+        slots[i].lastUse = 0;
+        slots[i].values.resize(T * T * T);
+    }
+
+    Counter zero;
+    memset(&zero, 0, sizeof(zero));
+    hits.assign(64, zero);
+    pthread_mutex_init(&loadMutex, NULL);
+}
+
+TiledVectorGrid::~TiledVectorGrid() {
+    pthread_mutex_destroy(&loadMutex);
+    close(fd);
+}
+
+void TiledVectorGrid::loadTile(size_t tile) const {
+    bool failed = false;
+    pthread_mutex_lock(&loadMutex);
+    {
+        // another thread may have loaded the tile in the meantime
+        if (__atomic_load_n(&slotOfTile[tile], __ATOMIC_ACQUIRE) < 0) {
+            // free slot, otherwise the least recently used one
+            size_t s = 0;
+            for (size_t i = 1; i < slots.size(); i++)
+                if (__atomic_load_n(&slots[i].lastUse, __ATOMIC_RELAXED) < __atomic_load_n(&slots[s].lastUse, __ATOMIC_RELAXED))
+                    s = i;
+            Slot &slot = slots[s];
+
+            // odd version: readers of the evicted tile retry
+            __atomic_store_n(&slot.version, slot.version + 1, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            if (slot.tile < slotOfTile.size())
+                __atomic_store_n(&slotOfTile[slot.tile], -1, __ATOMIC_RELEASE);
+
+            std::vector<unsigned char> data(tileBytes);
+            off_t offset = dataOffset + (unsigned long long) tile * tileBytes;
+            failed = (pread(fd, &data[0], tileBytes, offset) != ssize_t(tileBytes));
+            if (not failed) {
+                CompressedVectorGrid::decodeValues(encoding, &data[0], scales[tile], 3 * slot.values.size(),
+                        &slot.values[0].x);
+                __atomic_store_n(&slot.tile, tile, __ATOMIC_RELAXED);
+                __atomic_store_n(&slot.lastUse, __atomic_add_fetch(&misses, 1, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+                __atomic_store_n(&slot.version, slot.version + 1, __ATOMIC_RELEASE);
+                __atomic_store_n(&slotOfTile[tile], long(s), __ATOMIC_RELEASE);
+            } else {
+                __atomic_store_n(&slot.tile, slotOfTile.size(), __ATOMIC_RELAXED);
+                __atomic_store_n(&slot.version, slot.version + 1, __ATOMIC_RELEASE);
+            }
+        }
+    }
+    pthread_mutex_unlock(&loadMutex);
+    if (failed)
+        throw std::runtime_error("TiledVectorGrid: could not read from " + filename);
+}
+
+Vector3f TiledVectorGrid::get(size_t ix, size_t iy, size_t iz) const {
+    size_t mask = (size_t(1) << tileBits) - 1;
+    size_t tile = ((ix >> tileBits) * NTy + (iy >> tileBits)) * NTz + (iz >> tileBits);
+    size_t inner = (((ix & mask) << tileBits) + (iy & mask)) << tileBits | (iz & mask);
+
+    bool loaded = false;
+    while (true) {
+        long s = __atomic_load_n(&slotOfTile[tile], __ATOMIC_ACQUIRE);
+        if (s < 0) {
+            loadTile(tile);
+            loaded = true;
+            continue;
+        }
+
+        // optimistic read, valid if the slot was not refilled meanwhile
+        Slot &slot = slots[s];
+        unsigned long version = __atomic_load_n(&slot.version, __ATOMIC_ACQUIRE);
+        if (version & 1)
+            continue;
+        size_t cachedTile = __atomic_load_n(&slot.tile, __ATOMIC_RELAXED);
+        Vector3f value = slot.values[inner];
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if ((cachedTile != tile) or (__atomic_load_n(&slot.version, __ATOMIC_RELAXED) != version))
+            continue;
+
+        if (not loaded) {
+#ifdef _OPENMP
+            Counter &counter = hits[omp_get_thread_num() % hits.size()];
+#else
+            Counter &counter = hits[0];
+#endif
+            __atomic_add_fetch(&counter.count, 1, __ATOMIC_RELAXED);
+        }
+        unsigned long now = __atomic_load_n(&misses, __ATOMIC_RELAXED);
+        if (__atomic_load_n(&slot.lastUse, __ATOMIC_RELAXED) != now)
+            __atomic_store_n(&slot.lastUse, now, __ATOMIC_RELAXED);
+        return value;
+    }
+}
+
+Vector3f TiledVectorGrid::closestValue(const Vector3d &position) const {
+    Vector3d r = (position - gridOrigin) / spacing;
+    int ix = round(r.x);
+    int iy = round(r.y);
+    int iz = round(r.z);
+    int nx = Nx, ny = Ny, nz = Nz;
+    if (reflective) {
+        ix = reflectiveIndex(ix, nx);
+        iy = reflectiveIndex(iy, ny);
+        iz = reflectiveIndex(iz, nz);
+    } else {
+        ix = ((ix % nx) + nx) % nx;
+        iy = ((iy % ny) + ny) % ny;
+        iz = ((iz % nz) + nz) % nz;
+    }
+    return get(ix, iy, iz);
+}
+
+Vector3f TiledVectorGrid::interpolate(const Vector3d &position) const {
+    // position on a unit grid
+    Vector3d r = (position - gridOrigin) / spacing;
+
+    // indices of lower and upper neighbors
+    int ix, iX, iy, iY, iz, iZ;
+    if (reflective) {
+        reflectiveClamp(r.x, Nx, ix, iX);
+        reflectiveClamp(r.y, Ny, iy, iY);
+        reflectiveClamp(r.z, Nz, iz, iZ);
+    } else {
+        periodicClamp(r.x, Nx, ix, iX);
+        periodicClamp(r.y, Ny, iy, iY);
+        periodicClamp(r.z, Nz, iz, iZ);
+    }
+
+    // linear fraction to lower and upper neighbors
+    double fx = r.x - floor(r.x);
+    double fX = 1 - fx;
+    double fy = r.y - floor(r.y);
+    double fY = 1 - fy;
+    double fz = r.z - floor(r.z);
+    double fZ = 1 - fz;
+
+    // trilinear interpolation, see Grid::interpolate
+    Vector3f b(0.);
+    b += get(ix, iy, iz) * fX * fY * fZ;
+    b += get(iX, iy, iz) * fx * fY * fZ;
+    b += get(ix, iY, iz) * fX * fy * fZ;
+    b += get(ix, iy, iZ) * fX * fY * fz;
+    b += get(iX, iy, iZ) * fx * fY * fz;
+    b += get(ix, iY, iZ) * fX * fy * fz;
+    b += get(iX, iY, iz) * fx * fy * fZ;
+    b += get(iX, iY, iZ) * fx * fy * fz;
+    return b;
+}
+
+void TiledVectorGrid::setReflective(bool b) {
+    reflective = b;
+}
+
+bool TiledVectorGrid::isReflective() const {
+    return reflective;
+}
+
+Vector3d TiledVectorGrid::getOrigin() const {
+    return origin;
+}
+
+size_t TiledVectorGrid::getNx() const {
+    return Nx;
+}
+
+size_t TiledVectorGrid::getNy() const {
+    return Ny;
+}
+
+size_t TiledVectorGrid::getNz() const {
+    return Nz;
+}
+
+double TiledVectorGrid::getSpacing() const {
+    return spacing;
+}
+
+size_t TiledVectorGrid::getTileSize() const {
+    return size_t(1) << tileBits;
+}
+
+size_t TiledVectorGrid::getCacheSize() const {
+    return slots.size();
+}
+
+unsigned long TiledVectorGrid::getCacheHits() const {
+    unsigned long sum = 0;
+    for (size_t i = 0; i < hits.size(); i++)
+        sum += __atomic_load_n(&hits[i].count, __ATOMIC_RELAXED);
+    return sum;
+}
+
+unsigned long TiledVectorGrid::getCacheMisses() const {
+    return misses;
+}
+
+void TiledVectorGrid::resetStatistics() {
+    for (size_t i = 0; i < hits.size(); i++)
+        hits[i].count = 0;
+    misses = 0;
+    for (size_t i = 0; i < slots.size(); i++)
+        slots[i].lastUse = 0;
+}
+
+} // namespace grpropa
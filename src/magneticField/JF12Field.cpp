@@ -165,9 +165,9 @@ Vector3d JF12Field::getRegularField(const Vector3d& pos) const {
     if ((d < 1 * kpc) or (d > 20 * kpc))
         return b; // 0 field for d < 1 kpc or d > 20 kpc
 
-    double phi = pos.getPhi(); // azimuth
-    double sinPhi = sin(phi);
-    double cosPhi = cos(phi);
+    // azimuth, its sine and cosine are taken from the position directly
+    double sinPhi = (r > 0) ? pos.y / r : 0;
+    double cosPhi = (r > 0) ? pos.x / r : 1;
 
     double lfDisk = logisticFunction(pos.z, hDisk, wDisk);
 
@@ -182,6 +182,7 @@ Vector3d JF12Field::getRegularField(const Vector3d& pos) const {
 
         } else {
             // spiral region
+            double phi = pos.getPhi();
             double r_negx = r * exp(-(phi - M_PI) / tan90MinusPitch);
             if (r_negx > rArms[7])
                 r_negx = r * exp(-(phi + M_PI) / tan90MinusPitch);
@@ -245,7 +246,6 @@ double JF12Field::getTurbulentStrength(const Vector3d& pos) const {
         return 0;
 
     double r = sqrt(pos.x * pos.x + pos.y * pos.y); // in-plane radius
-    double phi = pos.getPhi(); // azimuth
 
     // disk
     double bDisk = 0;
@@ -253,6 +253,7 @@ double JF12Field::getTurbulentStrength(const Vector3d& pos) const {
         bDisk = bDiskTurb5;
     } else {
         // spiral region
+        double phi = pos.getPhi(); // azimuth
         double r_negx = r * exp(-(phi - M_PI) / tan90MinusPitch);
         if (r_negx > rArms[7])
             r_negx = r * exp(-(phi + M_PI) / tan90MinusPitch);
@@ -290,4 +291,35 @@ Vector3d JF12Field::getField(const Vector3d& pos) const {
     return b;
 }
 
+void JF12Field::getFields(const double *x, const double *y, const double *z, double *bx, double *by, double *bz,
+        size_t n) const {
+    for (size_t i = 0; i < n; i++)
+        bx[i] = by[i] = bz[i] = 0;
+
+    // one pass per component, so that the grids of the random components are traversed in order
+    if (useTurbulent) {
+        for (size_t i = 0; i < n; i++) {
+            Vector3d pos(x[i], y[i], z[i]);
+            double s = getTurbulentStrength(pos);
+            if (s == 0)
+                continue; // the grid is not needed outside of the galaxy
+            Vector3d b = turbulentGrid->interpolate(pos) * s;
+            bx[i] += b.x;
+            by[i] += b.y;
+            bz[i] += b.z;
+        }
+    }
+    if (useStriated or useRegular) {
+        for (size_t i = 0; i < n; i++) {
+            Vector3d pos(x[i], y[i], z[i]);
+            Vector3d b = getRegularField(pos);
+            if (useStriated and (b.getR2() > 0)) // the striated grid is not needed where the regular field vanishes
+                b *= 1. + sqrtbeta * striatedGrid->closestValue(pos);
+            bx[i] += b.x;
+            by[i] += b.y;
+            bz[i] += b.z;
+        }
+    }
+}
+
 } // namespace grpropa
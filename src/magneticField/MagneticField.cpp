@@ -1,7 +1,22 @@
 #include "grpropa/magneticField/MagneticField.h"
 
+#include <algorithm>
+
 namespace grpropa {
 
+void MagneticField::getFields(const double *x, const double *y, const double *z, double *bx, double *by,
+        double *bz, size_t n) const {
+    for (size_t i = 0; i < n; i++) {
+        Vector3d b = getField(Vector3d(x[i], y[i], z[i]));
+        bx[i] = b.x;
+        by[i] = b.y;
+        bz[i] = b.z;
+    }
+}
+
+// positions are passed on to decorated fields in chunks of this size
+static const size_t chunkSize = 256;
+
 PeriodicMagneticField::PeriodicMagneticField(ref_ptr<MagneticField> field, const Vector3d &extends) :
     field(field), extends(extends), origin(0, 0, 0), reflective(false) {
 
@@ -55,6 +70,31 @@ Vector3d PeriodicMagneticField::getField(const Vector3d &position) const {
     return field->getField(p);
 }
 
+void PeriodicMagneticField::getFields(const double *x, const double *y, const double *z, double *bx, double *by,
+        double *bz, size_t n) const {
+    double p[3][chunkSize];
+    for (size_t i0 = 0; i0 < n; i0 += chunkSize) {
+        size_t m = std::min(chunkSize, n - i0);
+        for (size_t i = 0; i < m; i++) {
+            Vector3d position(x[i0 + i], y[i0 + i], z[i0 + i]);
+            Vector3d cell = ((position - origin) / extends).floor();
+            Vector3d q = position - origin - cell * extends;
+            if (reflective) {
+                if ((long) ::fabs(cell.x) % 2 == 1)
+                    q.x = extends.x - q.x;
+                if ((long) ::fabs(cell.y) % 2 == 1)
+                    q.y = extends.y - q.y;
+                if ((long) ::fabs(cell.z) % 2 == 1)
+                    q.z = extends.z - q.z;
+            }
+            p[0][i] = q.x;
+            p[1][i] = q.y;
+            p[2][i] = q.z;
+        }
+        field->getFields(p[0], p[1], p[2], bx + i0, by + i0, bz + i0, m);
+    }
+}
+
 void MagneticFieldList::addField(ref_ptr<MagneticField> field) {
     fields.push_back(field);
 }
@@ -66,4 +106,22 @@ Vector3d MagneticFieldList::getField(const Vector3d &position) const {
     return b;
 }
 
+void MagneticFieldList::getFields(const double *x, const double *y, const double *z, double *bx, double *by,
+        double *bz, size_t n) const {
+    for (size_t i = 0; i < n; i++)
+        bx[i] = by[i] = bz[i] = 0;
+    double b[3][chunkSize];
+    for (size_t i0 = 0; i0 < n; i0 += chunkSize) {
+        size_t m = std::min(chunkSize, n - i0);
+        for (size_t j = 0; j < fields.size(); j++) {
+            fields[j]->getFields(x + i0, y + i0, z + i0, b[0], b[1], b[2], m);
+            for (size_t i = 0; i < m; i++) {
+                bx[i0 + i] += b[0][i];
+                by[i0 + i] += b[1][i];
+                bz[i0 + i] += b[2][i];
+            }
+        }
+    }
+}
+
 } // namespace grpropa
@@ -2,22 +2,106 @@
 
 namespace grpropa {
 
-MagneticFieldGrid::MagneticFieldGrid(ref_ptr<VectorGrid> grid) {
+MagneticFieldGrid::MagneticFieldGrid(ref_ptr<VectorGrid> grid) :
+        nearestCell(false) {
+    setGrid(grid);
+}
+
+MagneticFieldGrid::MagneticFieldGrid(ref_ptr<CompressedVectorGrid> grid) :
+        nearestCell(false) {
+    setGrid(grid);
+}
+
+MagneticFieldGrid::MagneticFieldGrid(ref_ptr<TiledVectorGrid> grid) :
+        nearestCell(false) {
     setGrid(grid);
 }
 
 void MagneticFieldGrid::setGrid(ref_ptr<VectorGrid> grid) {
     this->grid = grid;
+    compressedGrid = NULL;
+    tiledGrid = NULL;
+}
+
+void MagneticFieldGrid::setGrid(ref_ptr<CompressedVectorGrid> grid) {
+    compressedGrid = grid;
+    this->grid = NULL;
+    tiledGrid = NULL;
+}
+
+void MagneticFieldGrid::setGrid(ref_ptr<TiledVectorGrid> grid) {
+    tiledGrid = grid;
+    this->grid = NULL;
+    compressedGrid = NULL;
 }
 
 ref_ptr<VectorGrid> MagneticFieldGrid::getGrid() {
     return grid;
 }
 
+ref_ptr<CompressedVectorGrid> MagneticFieldGrid::getCompressedGrid() {
+    return compressedGrid;
+}
+
+ref_ptr<TiledVectorGrid> MagneticFieldGrid::getTiledGrid() {
+    return tiledGrid;
+}
+
+void MagneticFieldGrid::setNearestCell(bool b) {
+    nearestCell = b;
+}
+
+bool MagneticFieldGrid::isNearestCell() const {
+    return nearestCell;
+}
+
 Vector3d MagneticFieldGrid::getField(const Vector3d &pos) const {
+    if (compressedGrid) {
+        if (nearestCell)
+            return compressedGrid->closestValue(pos);
+        return compressedGrid->interpolate(pos);
+    }
+    if (tiledGrid) {
+        if (nearestCell)
+            return tiledGrid->closestValue(pos);
+        return tiledGrid->interpolate(pos);
+    }
+    if (nearestCell)
+        return grid->closestValue(pos);
     return grid->interpolate(pos);
 }
 
+// the type of grid and of interpolation are resolved once per batch instead of once per position
+template<class G>
+static void gridFields(const G &grid, bool nearestCell, const double *x, const double *y, const double *z,
+        double *bx, double *by, double *bz, size_t n) {
+    if (nearestCell) {
+        for (size_t i = 0; i < n; i++) {
+            Vector3f b = grid.closestValue(Vector3d(x[i], y[i], z[i]));
+            bx[i] = b.x;
+            by[i] = b.y;
+            bz[i] = b.z;
+        }
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            Vector3f b = grid.interpolate(Vector3d(x[i], y[i], z[i]));
+            bx[i] = b.x;
+            by[i] = b.y;
+            bz[i] = b.z;
+        }
+    }
+}
+
+void MagneticFieldGrid::getFields(const double *x, const double *y, const double *z, double *bx, double *by,
+        double *bz, size_t n) const {
+    if (compressedGrid)
+        gridFields(*compressedGrid, nearestCell, x, y, z, bx, by, bz, n);
+    else if (tiledGrid)
+        gridFields(*tiledGrid, nearestCell, x, y, z, bx, by, bz, n);
+    else
+        gridFields(*grid, nearestCell, x, y, z, bx, by, bz, n);
+}
+
 ModulatedMagneticFieldGrid::ModulatedMagneticFieldGrid(ref_ptr<VectorGrid> grid, ref_ptr<ScalarGrid> modGrid) {
     grid->setReflective(false);
     modGrid->setReflective(true);
@@ -25,14 +109,31 @@ ModulatedMagneticFieldGrid::ModulatedMagneticFieldGrid(ref_ptr<VectorGrid> grid,
     setModulationGrid(modGrid);
 }
 
+ModulatedMagneticFieldGrid::ModulatedMagneticFieldGrid(ref_ptr<CompressedVectorGrid> grid, ref_ptr<ScalarGrid> modGrid) {
+    grid->setReflective(false);
+    modGrid->setReflective(true);
+    setGrid(grid);
+    setModulationGrid(modGrid);
+}
+
 void ModulatedMagneticFieldGrid::setGrid(ref_ptr<VectorGrid> g) {
     grid = g;
+    compressedGrid = NULL;
+}
+
+void ModulatedMagneticFieldGrid::setGrid(ref_ptr<CompressedVectorGrid> g) {
+    compressedGrid = g;
+    grid = NULL;
 }
 
 ref_ptr<VectorGrid> ModulatedMagneticFieldGrid::getGrid() {
     return grid;
 }
 
+ref_ptr<CompressedVectorGrid> ModulatedMagneticFieldGrid::getCompressedGrid() {
+    return compressedGrid;
+}
+
 void ModulatedMagneticFieldGrid::setModulationGrid(ref_ptr<ScalarGrid> g) {
     modGrid = g;
 }
@@ -42,13 +143,16 @@ ref_ptr<ScalarGrid> ModulatedMagneticFieldGrid::getModulationGrid() {
 }
 
 void ModulatedMagneticFieldGrid::setReflective(bool gridReflective, bool modGridReflective) {
-    grid->setReflective(gridReflective);
+    if (compressedGrid)
+        compressedGrid->setReflective(gridReflective);
+    else
+        grid->setReflective(gridReflective);
     modGrid->setReflective(modGridReflective);
 }
 
 Vector3d ModulatedMagneticFieldGrid::getField(const Vector3d &pos) const {
     float m = modGrid->interpolate(pos);
-    Vector3d b = grid->interpolate(pos);
+    Vector3d b = compressedGrid ? compressedGrid->interpolate(pos) : grid->interpolate(pos);
     return b * m;
 }
 
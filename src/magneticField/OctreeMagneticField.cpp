@@ -0,0 +1,335 @@
+#include "grpropa/magneticField/OctreeMagneticField.h"
+
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+namespace grpropa {
+
+// Samples a field on the octree, positions are integer coordinates in units of the smallest cell
+struct OctreeBuilder {
+    typedef unsigned long long Key;
+
+    ref_ptr<MagneticField> field;
+    Vector3d origin;
+    double cellSize;
+    size_t maxLevel, minLevel;
+    double tolerance;
+    std::vector<OctreeMagneticField::Node> &nodes;
+    std::vector<Vector3f> &values;
+    size_t depth;
+    std::map<Key, Vector3d> samples; // every evaluation of the field
+    std::map<Key, unsigned int> vertices; // samples that are corners of a cell
+
+    OctreeBuilder(std::vector<OctreeMagneticField::Node> &nodes, std::vector<Vector3f> &values) :
+            nodes(nodes), values(values), depth(0) {
+    }
+
+    Vector3d sample(Key ix, Key iy, Key iz) {
+        Key key = (ix << 42) | (iy << 21) | iz;
+        std::map<Key, Vector3d>::iterator it = samples.find(key);
+        if (it != samples.end())
+            return it->second;
+        Vector3d b = field->getField(origin + Vector3d(ix, iy, iz) * cellSize);
+        samples[key] = b;
+        return b;
+    }
+
+    unsigned int vertex(Key ix, Key iy, Key iz) {
+        Key key = (ix << 42) | (iy << 21) | iz;
+        std::map<Key, unsigned int>::iterator it = vertices.find(key);
+        if (it != vertices.end())
+            return it->second;
+        unsigned int i = values.size();
+        values.push_back(Vector3f(sample(ix, iy, iz)));
+        vertices[key] = i;
+        return i;
+    }
+
+    // largest deviation of the field at the centers of the faces, edges and cell from the interpolation of the corners,
+    // these are the corners of the children
+    double deviation(size_t node, Key ix, Key iy, Key iz, Key h) {
+        Vector3d c[8];
+        for (int i = 0; i < 8; i++)
+            c[i] = Vector3d(values[nodes[node].corner[i]]);
+        double d = 0;
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 3; j++)
+                for (int k = 0; k < 3; k++) {
+                    if ((i != 1) and (j != 1) and (k != 1))
+                        continue; // corner
+                    Vector3d b(0.);
+                    for (int n = 0; n < 8; n++) {
+                        int dx = (n >> 2) & 1, dy = (n >> 1) & 1, dz = n & 1;
+                        b += c[n] * (dx ? i : 2 - i) * (dy ? j : 2 - j) * (dz ? k : 2 - k) / 8.;
+                    }
+                    d = std::max(d, (sample(ix + i * h, iy + j * h, iz + k * h) - b).getR());
+                }
+        return d;
+    }
+
+    void build(size_t node, size_t level, Key ix, Key iy, Key iz) {
+        depth = std::max(depth, level);
+        Key h = Key(1) << (maxLevel - level);
+        for (int i = 0; i < 8; i++)
+            nodes[node].corner[i] = vertex(ix + h * ((i >> 2) & 1), iy + h * ((i >> 1) & 1), iz + h * (i & 1));
+        nodes[node].child = -1;
+        if (level == maxLevel)
+            return;
+        if ((level >= minLevel) and (deviation(node, ix, iy, iz, h / 2) <= tolerance))
+            return;
+
+        size_t first = nodes.size();
+        if (first + 8 > 0x7fffffff)
+            throw std::runtime_error("OctreeMagneticField: too many nodes");
+        nodes.resize(first + 8);
+        nodes[node].child = first;
+        for (int i = 0; i < 8; i++)
+            build(first + i, level + 1, ix + h / 2 * ((i >> 2) & 1), iy + h / 2 * ((i >> 1) & 1),
+                    iz + h / 2 * (i & 1));
+    }
+
+    // leaf that contains a point given in units of half the smallest cell, with its level and lower corner
+    size_t leaf(Key px, Key py, Key pz, size_t &level, Key &cx, Key &cy, Key &cz) const {
+        size_t n = 0;
+        level = 0;
+        cx = cy = cz = 0;
+        while (nodes[n].child >= 0) {
+            Key shift = maxLevel - level;
+            Key ox = (px >> shift) & 1, oy = (py >> shift) & 1, oz = (pz >> shift) & 1;
+            cx += ox << shift;
+            cy += oy << shift;
+            cz += oz << shift;
+            n = nodes[n].child + ((ox << 2) | (oy << 1) | oz);
+            level++;
+        }
+        return n;
+    }
+
+    struct Constraint {
+        unsigned int vertex;
+        size_t leaf;
+        double fx, fy, fz; // position of the vertex in the leaf
+    };
+
+    // Makes the field continuous where cells of different levels meet: each vertex is set to the interpolation of
+    // the coarsest leaf that touches it. Vertices are processed from coarse to fine levels, so that the corners of
+    // that leaf are already final. Since the interpolation is linear along edges and bilinear on faces, the finer
+    // leaves then reproduce the coarse interpolation on the shared faces.
+    void constrain() {
+        Key nHalf = Key(1) << (maxLevel + 1);
+        std::vector<std::vector<Constraint> > byLevel(maxLevel + 1);
+        for (std::map<Key, unsigned int>::iterator it = vertices.begin(); it != vertices.end(); ++it) {
+            Key v[3] = { it->first >> 42, (it->first >> 21) & 0x1fffff, it->first & 0x1fffff };
+            Constraint c;
+            size_t coarsest = maxLevel + 1;
+            for (int o = 0; o < 8; o++) {
+                Key p[3];
+                bool inside = true;
+                for (int a = 0; a < 3; a++) {
+                    bool up = (o >> (2 - a)) & 1;
+                    if ((not up and (v[a] == 0)) or (up and (2 * v[a] + 1 >= nHalf)))
+                        inside = false;
+                    p[a] = up ? 2 * v[a] + 1 : 2 * v[a] - 1;
+                }
+                if (not inside)
+                    continue;
+                size_t level;
+                Key cx, cy, cz;
+                size_t n = leaf(p[0], p[1], p[2], level, cx, cy, cz);
+                if (level >= coarsest)
+                    continue;
+                double cellSize = double(Key(1) << (maxLevel + 1 - level));
+                coarsest = level;
+                c.leaf = n;
+                c.fx = (2 * v[0] - cx) / cellSize;
+                c.fy = (2 * v[1] - cy) / cellSize;
+                c.fz = (2 * v[2] - cz) / cellSize;
+            }
+            c.vertex = it->second;
+            byLevel[coarsest].push_back(c);
+        }
+
+        for (size_t l = 0; l <= maxLevel; l++) {
+            for (size_t i = 0; i < byLevel[l].size(); i++) {
+                const Constraint &c = byLevel[l][i];
+                const unsigned int *corner = nodes[c.leaf].corner;
+                Vector3d b(0.);
+                for (int n = 0; n < 8; n++) {
+                    double w = (((n >> 2) & 1) ? c.fx : 1 - c.fx) * (((n >> 1) & 1) ? c.fy : 1 - c.fy)
+                            * ((n & 1) ? c.fz : 1 - c.fz);
+                    if (w != 0)
+                        b += Vector3d(values[corner[n]]) * w;
+                }
+                values[c.vertex] = Vector3f(b);
+            }
+        }
+    }
+};
+
+OctreeMagneticField::OctreeMagneticField(ref_ptr<MagneticField> field, Vector3d origin, double size,
+        size_t maxLevel, double tolerance, size_t minLevel) :
+        origin(origin), size(size) {
+    if (maxLevel > 20)
+        throw std::runtime_error("OctreeMagneticField: maxLevel > 20");
+
+    OctreeBuilder builder(nodes, values);
+    builder.field = field;
+    builder.origin = origin;
+    builder.cellSize = size / (1 << maxLevel);
+    builder.maxLevel = maxLevel;
+    builder.minLevel = minLevel;
+    builder.tolerance = tolerance;
+    nodes.resize(1);
+    builder.build(0, 0, 0, 0, 0);
+    builder.constrain();
+    depth = builder.depth;
+}
+
+struct OctreeFileHeader {
+    char magic[8]; // "GRPOCTR"
+    unsigned int version;
+    unsigned int depth;
+    double origin[3];
+    double size;
+    unsigned long long nodes;
+    unsigned long long values;
+};
+
+static const char octreeFileMagic[8] = "GRPOCTR";
+
+OctreeMagneticField::OctreeMagneticField(std::string filename) {
+    std::ifstream fin(filename.c_str(), std::ios::binary);
+    if (!fin) {
+        std::stringstream ss;
+        ss << "OctreeMagneticField: " << filename << " not found";
+        throw std::runtime_error(ss.str());
+    }
+
+    OctreeFileHeader header;
+    fin.read((char*) &header, sizeof(header));
+    if (!fin or (memcmp(header.magic, octreeFileMagic, sizeof(header.magic)) != 0) or (header.version != 1))
+        throw std::runtime_error("OctreeMagneticField: " + filename + " is not an octree file");
+    origin = Vector3d(header.origin[0], header.origin[1], header.origin[2]);
+    size = header.size;
+    depth = header.depth;
+    nodes.resize(header.nodes);
+    values.resize(header.values);
+    if (header.nodes > 0)
+        fin.read((char*) &nodes[0], nodes.size() * sizeof(Node));
+    if (header.values > 0)
+        fin.read((char*) &values[0], values.size() * sizeof(Vector3f));
+    if (!fin)
+        throw std::runtime_error("OctreeMagneticField: " + filename + " is truncated");
+
+    // queries do not check indices, so reject inconsistent files here
+    bool valid = (nodes.size() > 0);
+    for (size_t i = 0; valid and (i < nodes.size()); i++) {
+        if ((nodes[i].child >= 0) and ((size_t(nodes[i].child) <= i) or (size_t(nodes[i].child) + 8 > nodes.size())))
+            valid = false;
+        for (int j = 0; j < 8; j++)
+            if (nodes[i].corner[j] >= values.size())
+                valid = false;
+    }
+    if (not valid)
+        throw std::runtime_error("OctreeMagneticField: " + filename + " is corrupt");
+}
+
+void OctreeMagneticField::save(std::string filename) const {
+    std::ofstream fout(filename.c_str(), std::ios::binary);
+    if (!fout) {
+        std::stringstream ss;
+        ss << "OctreeMagneticField: " << filename << " could not be opened";
+        throw std::runtime_error(ss.str());
+    }
+
+    OctreeFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, octreeFileMagic, sizeof(header.magic));
+    header.version = 1;
+    header.depth = depth;
+    header.origin[0] = origin.x;
+    header.origin[1] = origin.y;
+    header.origin[2] = origin.z;
+    header.size = size;
+    header.nodes = nodes.size();
+    header.values = values.size();
+    fout.write((char*) &header, sizeof(header));
+    fout.write((char*) &nodes[0], nodes.size() * sizeof(Node));
+    if (values.size() > 0)
+        fout.write((char*) &values[0], values.size() * sizeof(Vector3f));
+    if (!fout)
+        throw std::runtime_error("OctreeMagneticField: could not write " + filename);
+}
+
+Vector3d OctreeMagneticField::getOrigin() const {
+    return origin;
+}
+
+double OctreeMagneticField::getSize() const {
+    return size;
+}
+
+size_t OctreeMagneticField::getNumberOfNodes() const {
+    return nodes.size();
+}
+
+size_t OctreeMagneticField::getNumberOfValues() const {
+    return values.size();
+}
+
+size_t OctreeMagneticField::getDepth() const {
+    return depth;
+}
+
+int OctreeMagneticField::getLevel(const Vector3d &position) const {
+    Vector3d r = (position - origin) / size;
+    if ((r.x < 0) or (r.x >= 1) or (r.y < 0) or (r.y >= 1) or (r.z < 0) or (r.z >= 1))
+        return -1;
+    int level = 0;
+    int n = 0;
+    while (nodes[n].child >= 0) {
+        r *= 2;
+        int ox = (r.x >= 1), oy = (r.y >= 1), oz = (r.z >= 1);
+        r -= Vector3d(ox, oy, oz);
+        n = nodes[n].child + ((ox << 2) | (oy << 1) | oz);
+        level++;
+    }
+    return level;
+}
+
+Vector3d OctreeMagneticField::getField(const Vector3d &position) const {
+    // position relative to the cube
+    Vector3d r = (position - origin) / size;
+    if ((r.x < 0) or (r.x >= 1) or (r.y < 0) or (r.y >= 1) or (r.z < 0) or (r.z >= 1))
+        return Vector3d(0.);
+
+    // descend to the leaf, r becomes the position within the current cell
+    int n = 0;
+    while (nodes[n].child >= 0) {
+        r *= 2;
+        int ox = (r.x >= 1), oy = (r.y >= 1), oz = (r.z >= 1);
+        r -= Vector3d(ox, oy, oz);
+        n = nodes[n].child + ((ox << 2) | (oy << 1) | oz);
+    }
+
+    // trilinear interpolation between the corners of the leaf
+    const unsigned int *c = nodes[n].corner;
+    double fx = r.x, fX = 1 - r.x;
+    double fy = r.y, fY = 1 - r.y;
+    double fz = r.z, fZ = 1 - r.z;
+    Vector3d b(0.);
+    b += Vector3d(values[c[0]]) * fX * fY * fZ;
+    b += Vector3d(values[c[1]]) * fX * fY * fz;
+    b += Vector3d(values[c[2]]) * fX * fy * fZ;
+    b += Vector3d(values[c[3]]) * fX * fy * fz;
+    b += Vector3d(values[c[4]]) * fx * fY * fZ;
+    b += Vector3d(values[c[5]]) * fx * fY * fz;
+    b += Vector3d(values[c[6]]) * fx * fy * fZ;
+    b += Vector3d(values[c[7]]) * fx * fy * fz;
+    return b;
+}
+
+} // namespace grpropa
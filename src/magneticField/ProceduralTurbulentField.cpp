@@ -0,0 +1,194 @@
+#include "grpropa/magneticField/ProceduralTurbulentField.h"
+#include "grpropa/GridTools.h"
+#include "grpropa/Random.h"
+
+#include <complex>
+#include <stdexcept>
+
+namespace grpropa {
+
+// rotations of the cube as signed permutations, (R v)_i = sign_i * v_perm_i
+struct CubeRotation {
+    int perm[3];
+    int sign[3];
+};
+
+static std::vector<CubeRotation> cubeRotations() {
+    static const int permutations[6][3] = { { 0, 1, 2 }, { 1, 2, 0 }, { 2, 0, 1 }, { 0, 2, 1 }, { 2, 1, 0 }, { 1, 0, 2 } };
+    std::vector<CubeRotation> rotations;
+    for (int p = 0; p < 6; p++) {
+        int parity = (p < 3) ? 1 : -1;
+        for (int s = 0; s < 8; s++) {
+            CubeRotation r;
+            int det = parity;
+            for (int i = 0; i < 3; i++) {
+                r.perm[i] = permutations[p][i];
+                r.sign[i] = ((s >> i) & 1) ? -1 : 1;
+                det *= r.sign[i];
+            }
+            if (det == 1)
+                rotations.push_back(r);
+        }
+    }
+    return rotations;
+}
+
+static const std::vector<CubeRotation> rotations = cubeRotations();
+
+// 64 bit finalizer of splitmix64
+static unsigned long long mix(unsigned long long h) {
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+// in-place sum a_j = sum_k a_k exp(2 pi i j k / N) along the axis of the N^3 array with the given stride
+static void inverseDFT(std::vector<std::complex<double> > &a, int N, int stride) {
+    std::vector<std::complex<double> > w(N);
+    for (int m = 0; m < N; m++)
+        w[m] = std::polar(1., 2 * M_PI * m / N);
+    int nLines = N * N;
+#pragma omp parallel for
+    for (int l = 0; l < nLines; l++) {
+        // first element of the line: l enumerates the other two axes
+        size_t i0 = size_t(l / stride) * stride * N + l % stride;
+        std::vector<std::complex<double> > line(N);
+        for (int k = 0; k < N; k++)
+            line[k] = a[i0 + size_t(k) * stride];
+        for (int j = 0; j < N; j++) {
+            std::complex<double> sum = 0;
+            for (int k = 0; k < N; k++)
+                sum += line[k] * w[(j * k) % N];
+            a[i0 + size_t(j) * stride] = sum;
+        }
+    }
+}
+
+ProceduralTurbulentField::ProceduralTurbulentField(ref_ptr<VectorGrid> tile, int seed) :
+        tile(tile) {
+    if ((tile->getNx() != tile->getNy()) or (tile->getNy() != tile->getNz()))
+        throw std::runtime_error("ProceduralTurbulentField: tile has to be cubic");
+    tile->setReflective(false);
+    tileSize = tile->getNx() * tile->getSpacing();
+    setSeed(seed);
+}
+
+ref_ptr<VectorGrid> ProceduralTurbulentField::createTile(size_t N, double spacing, double Brms, double lMin,
+        double lMax, double alpha, int seed) {
+    double L = N * spacing;
+    if (lMin < 2 * spacing)
+        throw std::runtime_error("ProceduralTurbulentField: lMin < 2 * spacing");
+    if (lMin >= lMax)
+        throw std::runtime_error("ProceduralTurbulentField: lMin >= lMax");
+    if (lMax > L)
+        throw std::runtime_error("ProceduralTurbulentField: lMax > tile size");
+
+    Random random;
+    if (seed != 0)
+        random.seed(seed);
+
+    // Fourier coefficients of the three field components, indexed by the wave numbers modulo N
+    size_t N3 = N * N * N;
+    std::vector<std::complex<double> > ax(N3), ay(N3), az(N3);
+    Vector3d n0(1, 1, 1); // arbitrary vector to construct orthogonal base
+
+    // modes with integer wave numbers (nx, ny, nz) are periodic in the tile, one of each pair of k and -k
+    int nMax = int(L / lMin);
+    for (int nx = 0; nx <= nMax; nx++) {
+        for (int ny = -nMax; ny <= nMax; ny++) {
+            for (int nz = -nMax; nz <= nMax; nz++) {
+                if ((nx == 0) and ((ny < 0) or ((ny == 0) and (nz <= 0))))
+                    continue;
+                Vector3d n(nx, ny, nz);
+                double k = n.getR() / L; // inverse wavelength
+                if ((k < 1 / lMax) or (k > 1 / lMin))
+                    continue;
+
+                // random orientation perpendicular to k, normal distributed amplitude and uniform phase
+                Vector3d ek = n / n.getR();
+                Vector3d e1 = (ek.getAngleTo(n0) < 1e-3) ? Vector3d(-1, 1, 0) : n0.cross(ek);
+                Vector3d e2 = ek.cross(e1);
+                e1 /= e1.getR();
+                e2 /= e2.getR();
+                double theta = 2 * M_PI * random.rand();
+                Vector3d b = (e1 * cos(theta) + e2 * sin(theta)) * random.randNorm() * pow(k, alpha / 2);
+                std::complex<double> phase = std::polar(1., 2 * M_PI * random.rand());
+
+                // wave numbers +-N/2 coincide on the grid, so coefficients are added
+                size_t i = ((nx + N) % N * N + (ny + N) % N) * N + (nz + N) % N;
+                ax[i] += b.x * phase;
+                ay[i] += b.y * phase;
+                az[i] += b.z * phase;
+            }
+        }
+    }
+
+    // exp(i k x) factorizes into the three axes, so the sum over the modes is done one axis at a time
+    for (int stride = 1; stride < (int) N3; stride *= N) {
+        inverseDFT(ax, N, stride);
+        inverseDFT(ay, N, stride);
+        inverseDFT(az, N, stride);
+    }
+
+    ref_ptr<VectorGrid> tile = new VectorGrid(Vector3d(0.), N, spacing);
+    for (size_t ix = 0; ix < N; ix++)
+        for (size_t iy = 0; iy < N; iy++)
+            for (size_t iz = 0; iz < N; iz++) {
+                size_t i = (ix * N + iy) * N + iz;
+                tile->get(ix, iy, iz) = Vector3f(ax[i].real(), ay[i].real(), az[i].real());
+            }
+
+    scaleGrid(tile, Brms / rmsFieldStrength(tile));
+    return tile;
+}
+
+void ProceduralTurbulentField::setSeed(int seed) {
+    this->seed = (unsigned int) seed;
+}
+
+int ProceduralTurbulentField::getSeed() const {
+    return (int) seed;
+}
+
+ref_ptr<VectorGrid> ProceduralTurbulentField::getTile() {
+    return tile;
+}
+
+Vector3d ProceduralTurbulentField::getField(const Vector3d &position) const {
+    // position in units of the tile size, relative to the centers of the cubes
+    Vector3d t = position / tileSize - Vector3d(0.5);
+    Vector3d c0 = t.floor();
+    Vector3d f = t - c0;
+    // smooth blending weights of the lower and upper cube in each direction
+    Vector3d s(f.x * f.x * (3 - 2 * f.x), f.y * f.y * (3 - 2 * f.y), f.z * f.z * (3 - 2 * f.z));
+    double p[3] = { position.x, position.y, position.z };
+
+    Vector3d b(0.);
+    double sumW2 = 0;
+    for (int corner = 0; corner < 8; corner++) {
+        int dx = (corner >> 2) & 1, dy = (corner >> 1) & 1, dz = corner & 1;
+        double w = (dx ? s.x : 1 - s.x) * (dy ? s.y : 1 - s.y) * (dz ? s.z : 1 - s.z);
+        if (w == 0)
+            continue;
+
+        // rotation and shift of this cube
+        unsigned long long h = mix(seed + 0x9e3779b97f4a7c15ULL);
+        h = mix(h ^ (unsigned long long) (long long) (c0.x + dx));
+        h = mix(h ^ (unsigned long long) (long long) (c0.y + dy));
+        h = mix(h ^ (unsigned long long) (long long) (c0.z + dz));
+        const CubeRotation &r = rotations[h % 24];
+        double shift[3] = { double((h >> 16) & 0xffff), double((h >> 32) & 0xffff), double(h >> 48) };
+
+        // look up the tile at R^T x + shift and rotate the field vector back, R b
+        double u[3];
+        for (int i = 0; i < 3; i++)
+            u[r.perm[i]] = r.sign[i] * p[i] + shift[r.perm[i]] / 65536 * tileSize;
+        Vector3f v = tile->interpolate(Vector3d(u[0], u[1], u[2]));
+        double a[3] = { v.x, v.y, v.z };
+        b += Vector3d(r.sign[0] * a[r.perm[0]], r.sign[1] * a[r.perm[1]], r.sign[2] * a[r.perm[2]]) * w;
+        sumW2 += w * w;
+    }
+    return b / sqrt(sumW2);
+}
+
+} // namespace grpropa
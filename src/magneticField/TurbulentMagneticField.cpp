@@ -1,22 +1,113 @@
 #include "grpropa/magneticField/TurbulentMagneticField.h"
 #include "grpropa/Units.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace grpropa {
 
+// GCC function multiversioning: the mode loops are compiled for AVX-512, AVX2 and the baseline instruction set,
+// the best version for the CPU is selected when the library is loaded
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+#define TARGET_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define TARGET_CLONES
+#endif
+
+// number of modes evaluated together
+static const int blockSize = 64;
+
+// Cody-Waite split of pi/2, the first two parts have trailing zero bits so that q * part is exact
+static const double pio2_1 = 1.57079625129699707031e+00;
+static const double pio2_2 = 7.54978941586159635335e-08;
+static const double pio2_3 = 5.39030285815811905290e-15;
+// above this phase the reduction loses accuracy and the libm functions are used
+static const double maxReducedPhase = 1e8;
+
+// adding and subtracting 1.5 * 2^52 rounds to the nearest integer, for |x| < 2^51
+static const double roundingShift = 6755399441055744.0;
+
+// sin and cos of n phases, polynomial coefficients on [-pi/4, pi/4] from Cephes
+// the loop is free of branches and integer conversions, so that it is vectorized
+TARGET_CLONES static void sinCos(const double *a, double *s, double *c, int n) {
+    for (int i = 0; i < n; i++) {
+        double q = (a[i] * M_2_PI + roundingShift) - roundingShift;
+        double r = ((a[i] - q * pio2_1) - q * pio2_2) - q * pio2_3;
+        double r2 = r * r;
+        double ps = ((((( 1.58962301576546568060e-10 * r2 - 2.50507477628578072866e-8) * r2
+                + 2.75573136213857245213e-6) * r2 - 1.98412698295895385996e-4) * r2
+                + 8.33333333332211858878e-3) * r2 - 1.66666666666666307295e-1) * r2 * r + r;
+        double pc = (((((-1.13585365213876817300e-11 * r2 + 2.08757008419747316778e-9) * r2
+                - 2.75573141792967388112e-7) * r2 + 2.48015872888517045348e-5) * r2
+                - 1.38888888888730564116e-3) * r2 + 4.16666666666665929218e-2) * r2 * r2 - 0.5 * r2 + 1;
+        // quadrant q mod 4: swap for odd q, negative sin for q = 2, 3 and negative cos for q = 1, 2
+        double h0 = (q * 0.5 - 0.25 + roundingShift) - roundingShift; // floor(q / 2)
+        double h1 = (q * 0.5 + 0.25 + roundingShift) - roundingShift; // floor((q + 1) / 2)
+        double swap = q - 2 * h0;
+        double sinSign = 1 - 2 * (h0 - 2 * ((h0 * 0.5 - 0.25 + roundingShift) - roundingShift));
+        double cosSign = 1 - 2 * (h1 - 2 * ((h1 * 0.5 - 0.25 + roundingShift) - roundingShift));
+        s[i] = sinSign * (swap * pc + (1 - swap) * ps);
+        c[i] = cosSign * (swap * ps + (1 - swap) * pc);
+    }
+    for (int i = 0; i < n; i++) {
+        if (std::abs(a[i]) > maxReducedPhase) {
+            s[i] = std::sin(a[i]);
+            c[i] = std::cos(a[i]);
+        }
+    }
+}
+
 TurbulentMagneticField::TurbulentMagneticField(double Brms, double lMin, double lMax, double spectralIndex, int nModes) {
     setTurbulenceProperties(Brms, lMin, lMax, spectralIndex, nModes);
     initialize();
 }
 
 Vector3d TurbulentMagneticField::getField(const Vector3d &position) const {
-    Vector3d b(0.);
-    double a;
-    for (int i = 0; i < nModes; i++) {
-        Mode mode = modes[i];
-        a = mode.k.dot(position) + mode.phase;
-        b += mode.amplitude * (cos(a) * mode.e1 - sin(a) * mode.e2);
+    double bx, by, bz;
+    getFields(&position.x, &position.y, &position.z, &bx, &by, &bz, 1);
+    return Vector3d(bx, by, bz);
+}
+
+// sum of the modes at n positions, outside of the class since virtual functions cannot be multiversioned
+TARGET_CLONES static void sumModes(const double *kx, const double *ky, const double *kz, const double *phase,
+        const double *e1x, const double *e1y, const double *e1z, const double *e2x, const double *e2y,
+        const double *e2z, int nTotal, const double *x, const double *y, const double *z, double *bx, double *by,
+        double *bz, size_t n) {
+    for (size_t j = 0; j < n; j++)
+        bx[j] = by[j] = bz[j] = 0;
+
+    double a[blockSize], sa[blockSize], ca[blockSize];
+    for (int i0 = 0; i0 < nTotal; i0 += blockSize) {
+        // the block of modes stays in cache while all positions are evaluated
+        int m = std::min(blockSize, nTotal - i0);
+        const double *kx_ = &kx[i0], *ky_ = &ky[i0], *kz_ = &kz[i0], *phase_ = &phase[i0];
+        const double *e1x_ = &e1x[i0], *e1y_ = &e1y[i0], *e1z_ = &e1z[i0];
+        const double *e2x_ = &e2x[i0], *e2y_ = &e2y[i0], *e2z_ = &e2z[i0];
+        for (size_t j = 0; j < n; j++) {
+            for (int i = 0; i < m; i++)
+                a[i] = kx_[i] * x[j] + ky_[i] * y[j] + kz_[i] * z[j] + phase_[i];
+            sinCos(a, sa, ca, m);
+            double sx = 0, sy = 0, sz = 0;
+            for (int i = 0; i < m; i++) {
+                sx += ca[i] * e1x_[i] - sa[i] * e2x_[i];
+                sy += ca[i] * e1y_[i] - sa[i] * e2y_[i];
+                sz += ca[i] * e1z_[i] - sa[i] * e2z_[i];
+            }
+            bx[j] += sx;
+            by[j] += sy;
+            bz[j] += sz;
+        }
+    }
+}
+
+void TurbulentMagneticField::getFields(const double *x, const double *y, const double *z, double *bx, double *by, double *bz, size_t n) const {
+    if (phase.empty()) {
+        for (size_t j = 0; j < n; j++)
+            bx[j] = by[j] = bz[j] = 0;
+        return;
     }
-    return b;
+    sumModes(&kx[0], &ky[0], &kz[0], &phase[0], &e1x[0], &e1y[0], &e1z[0], &e2x[0], &e2y[0], &e2z[0],
+            phase.size(), x, y, z, bx, by, bz, n);
 }
 
 void TurbulentMagneticField::setTurbulenceProperties(double Brms, double lMin, double lMax, double spectralIndex, int nModes) {
@@ -36,11 +127,24 @@ void TurbulentMagneticField::initialize() {
     double dlk = (lkMax - lkMin) / (nModes - 1);
     double Lc = getCorrelationLength();
 
-    Mode mode;
+    kx.resize(nModes);
+    ky.resize(nModes);
+    kz.resize(nModes);
+    e1x.resize(nModes);
+    e1y.resize(nModes);
+    e1z.resize(nModes);
+    e2x.resize(nModes);
+    e2y.resize(nModes);
+    e2z.resize(nModes);
+    phase.resize(nModes);
+    std::vector<double> Gk(nModes);
+
     Vector3f ek, e1, e2; // orthogonal base
     Vector3f n0(1, 1, 1); // arbitrary vector to construct orthogonal base
 
+    // keep the order of the random numbers per mode, so that a seed always gives the same realisation
     double sumGk = 0;
+    std::vector<Vector3d> b1(nModes), b2(nModes);
     for (int i = 0; i < nModes; i++) {
         // construct an orthogonal base ek, e1, e2
         ek = random.randVector();
@@ -54,26 +158,35 @@ void TurbulentMagneticField::initialize() {
             e2 = ek.cross(e1);
         }
         double k = pow(10, lkMin + i * dlk);
-        mode.k = ek * k;
+        Vector3d kv = ek * k;
+        kx[i] = kv.x;
+        ky[i] = kv.y;
+        kz[i] = kv.z;
 
-        // amplitude (this seems to be wrong)
+        // relative power of the mode, normalized below
         double dk = k * dlk;
-        double Gk = k * k * dk / (1 + pow(k * Lc, -spectralIndex));
-        sumGk += Gk;
-        mode.amplitude = Brms * sqrt(Gk);
+        Gk[i] = k * k * dk / (1 + pow(k * Lc, -spectralIndex));
+        sumGk += Gk[i];
 
         // random orientation of b
         double alpha = random.rand(2 * M_PI);
-        mode.e1 = e1 / e1.getR() * cos(alpha);
-        mode.e2 = e2 / e2.getR() * sin(alpha);
+        b1[i] = e1 / e1.getR() * cos(alpha);
+        b2[i] = e2 / e2.getR() * sin(alpha);
 
         // random phase
-        mode.phase = random.rand(2 * M_PI);
-        modes.push_back(mode);
+        phase[i] = random.rand(2 * M_PI);
     }
 
-    for (int i = 0; i < nModes; i++)
-        modes[i].amplitude /= sumGk;
+    // <B^2> = sum amplitude^2 / 2, since the field of each mode rotates in the plane perpendicular to k
+    for (int i = 0; i < nModes; i++) {
+        double amplitude = Brms * sqrt(2 * Gk[i] / sumGk);
+        e1x[i] = amplitude * b1[i].x;
+        e1y[i] = amplitude * b1[i].y;
+        e1z[i] = amplitude * b1[i].z;
+        e2x[i] = amplitude * b2[i].x;
+        e2y[i] = amplitude * b2[i].y;
+        e2z[i] = amplitude * b2[i].z;
+    }
 }
 
 void TurbulentMagneticField::initialize(int seed) {
@@ -1,6 +1,9 @@
 #include "grpropa/module/Boundary.h"
 #include "grpropa/Units.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <sstream>
 
 namespace grpropa {
@@ -122,6 +125,8 @@ void CubicBoundary::process(Candidate *c) const {
     double lo = r.min();
     double hi = r.max();
     if ((lo <= 0) or (hi >= size)) {
+        if (makeRejectedInactive)
+            c->interpolateCurrentState(crossingFraction(c));
         reject(c);
     }
     if (limitStep) {
@@ -130,6 +135,24 @@ void CubicBoundary::process(Candidate *c) const {
     }
 }
 
+double CubicBoundary::crossingFraction(const Candidate *c) const {
+    Vector3d r0 = c->previous.getPosition() - origin;
+    Vector3d r1 = c->current.getPosition() - origin;
+    if ((r0.min() <= 0) or (r0.max() >= size))
+        return 1; // already outside before the step
+    // first face crossed along the step
+    double a[3] = {r0.x, r0.y, r0.z};
+    double b[3] = {r1.x, r1.y, r1.z};
+    double fraction = 1;
+    for (int i = 0; i < 3; i++) {
+        if (b[i] <= 0)
+            fraction = std::min(fraction, a[i] / (a[i] - b[i]));
+        else if (b[i] >= size)
+            fraction = std::min(fraction, (size - a[i]) / (b[i] - a[i]));
+    }
+    return fraction;
+}
+
 void CubicBoundary::setOrigin(Vector3d o) {
     origin = o;
 }
@@ -154,6 +177,23 @@ std::string CubicBoundary::getDescription() const {
     return s.str();
 }
 
+double CubicBoundary::distanceToRejection(const Vector3d &position, const Vector3d &direction) const {
+    Vector3d r = position - origin;
+    if ((r.min() <= 0) or (r.max() >= size))
+        return 0;
+    // exit through the first face along the ray
+    double rs[3] = {r.x, r.y, r.z};
+    double ds[3] = {direction.x, direction.y, direction.z};
+    double distance = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < 3; i++) {
+        if (ds[i] > 0)
+            distance = std::min(distance, (size - rs[i]) / ds[i]);
+        else if (ds[i] < 0)
+            distance = std::min(distance, -rs[i] / ds[i]);
+    }
+    return distance;
+}
+
 SphericalBoundary::SphericalBoundary() :
         center(Vector3d(0, 0, 0)), radius(0), limitStep(false), margin(0) {
 }
@@ -165,12 +205,26 @@ SphericalBoundary::SphericalBoundary(Vector3d c, double r) :
 void SphericalBoundary::process(Candidate *c) const {
     double d = (c->current.getPosition() - center).getR();
     if (d >= radius) {
+        if (makeRejectedInactive)
+            c->interpolateCurrentState(crossingFraction(c));
         reject(c);
     }
     if (limitStep)
         c->limitNextStep(radius - d + margin);
 }
 
+double SphericalBoundary::crossingFraction(const Candidate *c) const {
+    Vector3d r = c->previous.getPosition() - center;
+    Vector3d s = c->current.getPosition() - c->previous.getPosition();
+    double rc = r.getR2() - radius * radius;
+    double a = s.getR2();
+    if ((rc >= 0) or (a == 0))
+        return 1; // already outside before the step
+    // exit root of |r + t s| = radius
+    double b = r.dot(s);
+    return std::min((-b + sqrt(b * b - a * rc)) / a, 1.);
+}
+
 void SphericalBoundary::setCenter(Vector3d c) {
     center = c;
 }
@@ -195,6 +249,16 @@ std::string SphericalBoundary::getDescription() const {
     return s.str();
 }
 
+double SphericalBoundary::distanceToRejection(const Vector3d &position, const Vector3d &direction) const {
+    Vector3d r = position - center;
+    double c = r.getR2() - radius * radius;
+    if (c >= 0)
+        return 0;
+    // exit through the sphere surface
+    double b = r.dot(direction);
+    return -b + sqrt(b * b - c);
+}
+
 EllipsoidalBoundary::EllipsoidalBoundary() :
         focalPoint1(Vector3d(0, 0, 0)), focalPoint2(Vector3d(0, 0, 0)), majorAxis(
                 0), limitStep(false), margin(0) {
@@ -209,12 +273,33 @@ void EllipsoidalBoundary::process(Candidate *c) const {
     Vector3d pos = c->current.getPosition();
     double d = pos.getDistanceTo(focalPoint1) + pos.getDistanceTo(focalPoint2);
     if (d >= majorAxis) {
+        if (makeRejectedInactive)
+            c->interpolateCurrentState(crossingFraction(c));
         reject(c);
     }
     if (limitStep)
         c->limitNextStep(majorAxis - d + margin);
 }
 
+double EllipsoidalBoundary::crossingFraction(const Candidate *c) const {
+    Vector3d pos0 = c->previous.getPosition();
+    Vector3d pos1 = c->current.getPosition();
+    if (pos0.getDistanceTo(focalPoint1) + pos0.getDistanceTo(focalPoint2) >= majorAxis)
+        return 1; // already outside before the step
+    // the ellipsoid is convex, bisect for the exit point along the step
+    double lo = 0;
+    double hi = 1;
+    for (int i = 0; i < 52; i++) {
+        double t = (lo + hi) / 2;
+        Vector3d x = pos0 + (pos1 - pos0) * t;
+        if (x.getDistanceTo(focalPoint1) + x.getDistanceTo(focalPoint2) >= majorAxis)
+            hi = t;
+        else
+            lo = t;
+    }
+    return hi;
+}
+
 void EllipsoidalBoundary::setFocalPoints(Vector3d f1, Vector3d f2) {
     focalPoint1 = f1;
     focalPoint2 = f2;
@@ -241,5 +326,22 @@ std::string EllipsoidalBoundary::getDescription() const {
     return s.str();
 }
 
+double EllipsoidalBoundary::distanceToRejection(const Vector3d &position, const Vector3d &direction) const {
+    // f(t) = |x(t) - F1| + |x(t) - F2| - majorAxis is convex along the ray, bisect for its positive root
+    if (position.getDistanceTo(focalPoint1) + position.getDistanceTo(focalPoint2) >= majorAxis)
+        return 0;
+    double lo = 0;
+    double hi = majorAxis;
+    for (int i = 0; i < 64; i++) {
+        double t = (lo + hi) / 2;
+        Vector3d x = position + direction * t;
+        if (x.getDistanceTo(focalPoint1) + x.getDistanceTo(focalPoint2) >= majorAxis)
+            hi = t;
+        else
+            lo = t;
+    }
+    return hi;
+}
+
 
 } // namespace grpropa
@@ -0,0 +1,125 @@
+#include "grpropa/module/ContinuousEnergyLoss.h"
+#include "grpropa/module/Redshift.h"
+#include "grpropa/Units.h"
+#include "grpropa/Cosmology.h"
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+namespace grpropa {
+
+ContinuousEnergyLoss::ContinuousEnergyLoss(bool redshift, double limit) {
+    setRedshift(redshift);
+    setRadiationDensity(0);
+    setLimit(limit);
+}
+
+void ContinuousEnergyLoss::setMagneticField(ref_ptr<MagneticField> field) {
+    this->field = field;
+}
+
+void ContinuousEnergyLoss::setRedshift(bool redshift) {
+    this->redshift = redshift;
+}
+
+void ContinuousEnergyLoss::setRadiationDensity(double density) {
+    this->radiationDensity = density;
+}
+
+void ContinuousEnergyLoss::setInverseCompton(ref_ptr<InverseCompton> inverseCompton) {
+    this->inverseCompton = inverseCompton;
+}
+
+void ContinuousEnergyLoss::setLimit(double limit) {
+    this->limit = limit;
+}
+
+double ContinuousEnergyLoss::lossCoefficient(const Vector3d &position, const Vector3d &direction, double z, double E,
+        Candidate *candidate) const {
+    // b in dE/dx = -b E^2 for comoving distances x, with the local loss rate divided by (1 + z)
+    double m2c4 = pow(mass_electron * c_squared, 2);
+    double b = 0;
+    if (field) {
+        // reuse the field if the propagation evaluated it at this position
+        Vector3d B;
+        if ((candidate == NULL) or not candidate->getCachedField(field, position, B))
+            B = field->getField(position);
+        double Bperp = direction.cross(B).getR() * pow(1 + z, 2);
+        double coulomb = mu0_vacPerm * c_squared / (4 * M_PI);
+        b += (2. / 3.) * coulomb * pow(eplus, 4) * Bperp * Bperp / (m2c4 * m2c4) * c_squared;
+    }
+    if ((radiationDensity > 0) and (not inverseCompton or (E < inverseCompton->getMinimumEnergy()))) {
+        const double ThomsonCrossSection = 6.6524587158e-29 * meter * meter;
+        b += (4. / 3.) * ThomsonCrossSection * radiationDensity * pow(1 + z, 4) / m2c4;
+    }
+    return b / (1 + z);
+}
+
+double ContinuousEnergyLoss::energyLossRate(Candidate *c) const {
+    double z = c->getRedshift();
+    double E = c->current.getEnergy();
+    double rate = 0;
+    if (redshift)
+        rate += hubbleRate(z) / c_light / (1 + z) * E;
+    if (std::abs(c->current.getId()) == 11)
+        rate += lossCoefficient(c->current.getPosition(), c->current.getDirection(), z, E, c) * E * E;
+    return rate;
+}
+
+void ContinuousEnergyLoss::process(Candidate *c) const {
+    double step = c->getCurrentStep();
+    double z0 = c->getRedshift();
+    double zm = z0;
+    double z1 = z0;
+    if (redshift and (z0 > std::numeric_limits<double>::min())) {
+        zm = redshiftAfterComovingDistance(z0, step / 2);
+        z1 = redshiftAfterComovingDistance(z0, step);
+        c->setRedshift(z1);
+        Redshift::updateCosmicTime(c, z0, z1, step);
+    }
+
+    // adiabatic loss: E ~ (1 + z)
+    double E0 = c->current.getEnergy();
+    double r = (1 + z1) / (1 + z0);
+
+    // radiative losses of electrons and positrons: int b r dx with Simpson's rule
+    double integral = 0;
+    double b1 = 0;
+    bool lepton = (std::abs(c->current.getId()) == 11);
+    if (lepton and (field or (radiationDensity > 0))) {
+        Vector3d x0 = c->previous.getPosition();
+        Vector3d x1 = c->current.getPosition();
+        Vector3d d0 = c->previous.getDirection();
+        Vector3d d1 = c->current.getDirection();
+        Vector3d dm = d0 + d1;
+        dm = (dm.getR() > 0) ? dm.getUnitVector() : d1;
+        double b0 = lossCoefficient(x0, d0, z0, E0, c);
+        double bm = lossCoefficient((x0 + x1) / 2, dm, zm, E0);
+        b1 = lossCoefficient(x1, d1, z1, E0, c);
+        integral = step / 6 * (b0 + 4 * bm * (1 + zm) / (1 + z0) + b1 * r);
+    }
+
+    double E = E0 * r / (1 + E0 * integral);
+    c->current.setEnergy(E);
+
+    // the solution is exact for a constant field, limit the step to resolve its variation
+    if (b1 > 0)
+        c->limitNextStep(limit / (b1 * E));
+}
+
+std::string ContinuousEnergyLoss::getDescription() const {
+    std::stringstream s;
+    s << "ContinuousEnergyLoss:";
+    if (redshift)
+        s << " redshift,";
+    if (field)
+        s << " synchrotron,";
+    if (radiationDensity > 0)
+        s << " Thomson scattering (U = " << radiationDensity / (eV / pow(centimeter, 3)) << " eV/cm^3"
+                << (inverseCompton ? " below InverseCompton" : "") << "),";
+    s << " limit = " << limit;
+    return s.str();
+}
+
+} // namespace grpropa
@@ -0,0 +1,122 @@
+#include "grpropa/module/DiffusionSDE.h"
+#include "grpropa/Random.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace grpropa {
+
+DiffusionSDE::DiffusionSDE(ref_ptr<TurbulentMagneticField> turbulence, ref_ptr<Module> orbitPropagation, double ratio, double epsilon, double maxStep) :
+        turbulence(turbulence) {
+    setOrbitPropagation(orbitPropagation);
+    setRatio(ratio);
+    setEpsilon(epsilon);
+    setMaximumStep(maxStep);
+}
+
+double DiffusionSDE::gyroradius(const ParticleState &particle) const {
+    return particle.getEnergy() / (std::abs(particle.getCharge()) * c_light * turbulence->getRMSFieldStrength());
+}
+
+double DiffusionSDE::meanFreePath(double rg) const {
+    double Lc = turbulence->getCorrelationLength();
+    double q = -turbulence->getPowerSpectralIndex() - 2;
+    return Lc * pow(rg / Lc, 2 - q);
+}
+
+bool DiffusionSDE::isDiffusive(const ParticleState &particle) const {
+    if (particle.getCharge() == 0)
+        return false;
+    return gyroradius(particle) < ratio * turbulence->getCorrelationLength();
+}
+
+void DiffusionSDE::process(Candidate *candidate) const {
+    ParticleState &current = candidate->current;
+    if (not isDiffusive(current)) {
+        orbitPropagation->process(candidate);
+        return;
+    }
+
+    // save the new previous particle state
+    candidate->previous = current;
+
+    double lambda = meanFreePath(gyroradius(current));
+    double step = clip(candidate->getNextStep(), lambda, std::max(maxStep, lambda));
+
+    // Wiener process with <dx^2> = 2 D dt per direction, dt = step / c
+    double dt = step / c_light;
+    double sigmaPar = sqrt(2 * c_light * lambda / 3 * dt);
+    double sigmaPerp = sqrt(epsilon) * sigmaPar;
+
+    Random &random = Random::instance();
+    Vector3d pos = current.getPosition();
+    Vector3d B0 = background ? background->getField(pos) : Vector3d(0.);
+    Vector3d dx;
+    if (B0.getR2() > 0) {
+        Vector3d n = B0 / B0.getR();
+        Vector3d e1 = n.cross(std::abs(n.x) < 0.9 ? Vector3d(1, 0, 0) : Vector3d(0, 1, 0));
+        e1 /= e1.getR();
+        Vector3d e2 = n.cross(e1);
+        dx = n * (sigmaPar * random.randNorm()) + e1 * (sigmaPerp * random.randNorm()) + e2 * (sigmaPerp * random.randNorm());
+    } else {
+        dx = Vector3d(random.randNorm(), random.randNorm(), random.randNorm()) * sigmaPar;
+    }
+
+    current.setPosition(pos + dx);
+    current.setDirection(random.randVector());
+    candidate->setCurrentStep(step);
+    candidate->setNextStep(maxStep);
+}
+
+void DiffusionSDE::setBackgroundField(ref_ptr<MagneticField> field) {
+    background = field;
+}
+
+void DiffusionSDE::setOrbitPropagation(ref_ptr<Module> propagation) {
+    if (!propagation)
+        throw std::runtime_error("DiffusionSDE: orbit propagation module required");
+    orbitPropagation = propagation;
+}
+
+void DiffusionSDE::setRatio(double r) {
+    if (r <= 0)
+        throw std::runtime_error("DiffusionSDE: ratio <= 0");
+    ratio = r;
+}
+
+void DiffusionSDE::setEpsilon(double e) {
+    if ((e < 0) or (e > 1))
+        throw std::runtime_error("DiffusionSDE: epsilon not in range 0-1");
+    epsilon = e;
+}
+
+void DiffusionSDE::setMaximumStep(double max) {
+    if (max <= 0)
+        throw std::runtime_error("DiffusionSDE: maxStep <= 0");
+    maxStep = max;
+}
+
+double DiffusionSDE::getRatio() const {
+    return ratio;
+}
+
+double DiffusionSDE::getEpsilon() const {
+    return epsilon;
+}
+
+double DiffusionSDE::getMaximumStep() const {
+    return maxStep;
+}
+
+std::string DiffusionSDE::getDescription() const {
+    std::stringstream s;
+    s << "Diffusive propagation for gyroradii below " << ratio << " correlation lengths";
+    s << ", epsilon: " << epsilon;
+    s << ", Maximum Step: " << maxStep / kpc << " kpc";
+    s << ", otherwise " << orbitPropagation->getDescription();
+    return s.str();
+}
+
+} // namespace grpropa
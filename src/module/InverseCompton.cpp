@@ -14,69 +14,70 @@ InverseCompton::InverseCompton(PhotonField photonField, double thinning, double
     setLimit(limit);
     setThresholdEnergy(ethr);
     setMaxNumberOfIterations(nMaxIterations);
+    setCacheTolerance(1e-3);
 }
 
 void InverseCompton::setPhotonField(PhotonField photonField) {
     this->photonField = photonField;
     switch (photonField) {
     case CMB:
-        redshiftDependence = false;
+        table.redshiftDependence = false;
         setDescription("Inverse Compton: CMB");
         initRate(getDataPath("ICS-CMB.txt"));
         initTableBackgroundEnergy(getDataPath("photonProbabilities-CMB.txt"));
         break;
     case EBL:  // default: Gilmore '12 IRB model
     case EBL_Gilmore12:
-        redshiftDependence = true;
+        table.redshiftDependence = true;
         setDescription("Inverse Compton: EBL Gilmore et al. 2012");
         initRate(getDataPath("ICS-EBL_Gilmore12.txt"));
         initTableBackgroundEnergy(getDataPath("photonProbabilities-EBL_Gilmore12.txt"));
         break;
     case EBL_Dominguez11:
-        redshiftDependence = true;
+        table.redshiftDependence = true;
         setDescription("Inverse Compton: EBL Dominguez et al. 2011");
         initRate(getDataPath("ICS-EBL_Dominguez11.txt"));
         initTableBackgroundEnergy(getDataPath("photonProbabilities-EBL_Dominguez11.txt"));
         break;
     case EBL_Dominguez11_UL:
-        redshiftDependence = true;
+        table.redshiftDependence = true;
         setDescription("Inverse Compton: EBL Dominguez et al. 2011 (upper limit)");
         initRate(getDataPath("ICS-EBL_Dominguez11_UL.txt"));
         initTableBackgroundEnergy(getDataPath("photonProbabilities-EBL_Dominguez11_UL.txt"));
         break;
     case EBL_Dominguez11_LL:
-        redshiftDependence = true;
+        table.redshiftDependence = true;
         setDescription("Inverse Compton: EBL Dominguez et al. 2011 (lower limit)");
         initRate(getDataPath("ICS-EBL_Dominguez11_LL.txt"));
         initTableBackgroundEnergy(getDataPath("photonProbabilities-EBL_Dominguez11_LL.txt"));
         break;
     case EBL_Finke10:
-        redshiftDependence = true;
+        table.redshiftDependence = true;
         setDescription("Inverse Compton: EBL Finke et al. 2010");
         initRate(getDataPath("ICS-EBL_Finke10.txt"));
         initTableBackgroundEnergy(getDataPath("photonProbabilities-EBL_Finke10.txt"));
         break;
     case EBL_Kneiske10:
-        redshiftDependence = true;
+        table.redshiftDependence = true;
         setDescription("Inverse Compton: EBL Kneiske & Dole 2010 (lower limit)");
         initRate(getDataPath("ICS-EBL_Kneiske10.txt"));
         initTableBackgroundEnergy(getDataPath("photonProbabilities-EBL_Kneiske10.txt"));
         break;
     case EBL_Franceschini08:
-        redshiftDependence = true;
+        table.redshiftDependence = true;
         setDescription("Inverse Compton: EBL Franceschini et al. 2008");
         initRate(getDataPath("ICS-EBL_Franceschini08.txt"));
         initTableBackgroundEnergy(getDataPath("photonProbabilities-EBL_Franceschini08.txt"));
         break;
     case CRB:
     case CRB_Protheroe96:
-        redshiftDependence = false;
+        table.redshiftDependence = false;
         setDescription("Inverse Compton: CRB Protheroe & Biermann 1996");
         initRate(getDataPath("ICS-CRB_Protheroe96.txt"));
         initTableBackgroundEnergy(getDataPath("photonProbabilities-CRB_Protheroe96.txt"));
         break;
     case CRB_ARCADE2:
-        redshiftDependence = false;
+        table.redshiftDependence = false;
         setDescription("Inverse Compton: CRB ARCADE2 2010");
         initRate(getDataPath("ICS-CRB_ARCADE2.txt"));
         initTableBackgroundEnergy(getDataPath("photonProbabilities-CRB_ARCADE2.txt"));
@@ -84,6 +85,57 @@ void InverseCompton::setPhotonField(PhotonField photonField) {
     default:
         throw std::runtime_error("Inverse Compton: unknown photon background");
     }
+    table.customTables = 0;
+    applyTableResolution();
+}
+
+void InverseCompton::setCustomPhotonField(ref_ptr<CustomPhotonField> field) {
+    setInteractionTables(inverseComptonTables(field));
+    setDescription("Inverse Compton: custom photon field");
+}
+
+void InverseCompton::setInteractionTables(ref_ptr<InteractionTables> tables) {
+    table.setInteractionTables(tables, "InverseCompton");
+    applyTableResolution();
+    setDescription("Inverse Compton: interaction tables");
+}
+
+void InverseCompton::setTableResolution(size_t nEnergies, size_t nProbabilities, bool singlePrecision) {
+    table.nTableEnergies = nEnergies;
+    table.nTableProbabilities = nProbabilities;
+    table.singlePrecision = singlePrecision;
+
+    // reload the original tables
+    std::string description = getDescription();
+    if (table.customTables)
+        setInteractionTables(table.customTables);
+    else
+        setPhotonField(photonField);
+    setDescription(description);
+}
+
+double InverseCompton::getMinimumEnergy() const {
+    return table.tableEnergyMin;
+}
+
+double InverseCompton::getRateTableError() const {
+    return table.rateTableError;
+}
+
+double InverseCompton::getPhotonTableError() const {
+    return table.photonTableError;
+}
+
+void InverseCompton::applyTableResolution() {
+    table.applyTableResolution();
+}
+
+double InverseCompton::tabulatedRate(double E, double z) const {
+    return table.rate(E, z);
+}
+
+double InverseCompton::tabulatedPhotonEnergy(double p, double z) const {
+    return table.photonEnergy(p, z);
 }
 
 void InverseCompton::setLimit(double limit) {
@@ -102,24 +154,32 @@ void InverseCompton::setMaxNumberOfIterations(double a) {
     this->nMaxIterations = a;
 }
 
+void InverseCompton::setCacheTolerance(double tolerance) {
+    this->cacheTolerance = tolerance;
+}
+
+double InverseCompton::getCacheTolerance() const {
+    return cacheTolerance;
+}
+
 void InverseCompton::initRate(std::string filename) {
 
-    if (redshiftDependence == false) {
+    if (table.redshiftDependence == false) {
         std::ifstream infile(filename.c_str());
         if (!infile.good())
             throw std::runtime_error("InverseCompton: could not open file " + filename);
    
         // clear previously loaded interaction rates
-        tabEnergy.clear();
-        tabRate.clear();
+        table.tabEnergy.clear();
+        table.tabRate.clear();
 
         while (infile.good()) {
             if (infile.peek() != '#') {
                 double a, b;
                 infile >> a >> b;
                 if (infile) {
-                    tabEnergy.push_back(a * eV);
-                    tabRate.push_back(b / Mpc);
+                    table.tabEnergy.push_back(a * eV);
+                    table.tabRate.push_back(b / Mpc);
                 }
             }
             infile.ignore(std::numeric_limits < std::streamsize > ::max(), '\n');
@@ -131,9 +191,9 @@ void InverseCompton::initRate(std::string filename) {
             throw std::runtime_error("InverseCompton: could not open file " + filename);
   
         // clear previously loaded interaction rates
-        tabEnergy.clear();
-        tabRate.clear();
-        tabRedshift.clear();
+        table.tabEnergy.clear();
+        table.tabRate.clear();
+        table.tabRedshift.clear();
 
         // size of vector is predefined and depends on the model
         int nc; // number of columns (redshifts + one column for energy)
@@ -143,31 +203,31 @@ void InverseCompton::initRate(std::string filename) {
             nc = 33;
             double redshifts[] = {0.00, 0.01, 0.02, 0.03, 0.04, 0.05, 0.07, 0.09, 0.10, 0.15, 0.20, 0.25, 0.30, 0.35, 0.40, 0.45, 0, 0.60, 0.70, 0.80, 0.90, 1.00, 1.20, 1.40, 1.60, 1.80, 2.00, 2.50, 3.00, 3.50, 4.00, 4.50, 4.99};
             for (int k=0; k<nc; k++) 
-                tabRedshift.push_back(redshifts[k]);
+                table.tabRedshift.push_back(redshifts[k]);
         }
         else if (photonField == EBL_Gilmore12) {
             nc = 20;
             double redshifts[] = {0, 0.015, 0.025, 0.044, 0.05, 0.2, 0.4, 0.5, 0.6, 0.8, 1.0, 1.25, 1.5, 2.0, 2.5, 3.0, 4.0, 5.0, 6.0, 7.0};
             for (int k=0; k<nc; k++) 
-                tabRedshift.push_back(redshifts[k]);
+                table.tabRedshift.push_back(redshifts[k]);
         }
         else if (photonField == EBL_Dominguez11 || photonField == EBL_Dominguez11_UL || photonField == EBL_Dominguez11_LL) {
             nc = 20;
             double redshifts[] = {0, 0.01, 0.03, 0.05, 0.1, 0.2, 0.3, 0.4, 0.5, 0.6, 0.8, 1.0, 1.25, 1.5, 2.0, 2.5, 3.0, 3.9};
             for (int k=0; k<nc; k++) 
-                tabRedshift.push_back(redshifts[k]);
+                table.tabRedshift.push_back(redshifts[k]);
         }
         else if (photonField == EBL_Kneiske10) {
             nc = 5;
             double redshifts[] = {0.0, 0.1, 0.3, 0.8, 2.0};
             for (int k=0; k<nc; k++) 
-                tabRedshift.push_back(redshifts[k]);
+                table.tabRedshift.push_back(redshifts[k]);
         }
         else if (photonField == EBL_Franceschini08) {
             nc = 11;
             double redshifts[] = {0.0, 0.2, 0.4, 0.6, 0.8, 1.0, 1.2, 1.4, 1.6, 1.8, 2.0};
             for (int k=0; k<nc; k++) 
-                tabRedshift.push_back(redshifts[k]);
+                table.tabRedshift.push_back(redshifts[k]);
         }
         else { 
             throw std::runtime_error("EBL model not defined for redshift-dependent treatment (or not defined at all).");
@@ -185,32 +245,32 @@ void InverseCompton::initRate(std::string filename) {
         }
 
         for (int j=0; j<nl; j++) 
-            tabEnergy.push_back(entries[0][j] * eV);
+            table.tabEnergy.push_back(entries[0][j] * eV);
         for (int i=1; i<=nc; i++)
             for (int j=0; j<nl; j++)
-                tabRate.push_back(entries[i][j] / Mpc);
+                table.tabRate.push_back(entries[i][j] / Mpc);
 
         infile.close();
     } // conditional: redshift dependent
 }
 
 void InverseCompton::initTableBackgroundEnergy(std::string filename) {
-  if (redshiftDependence == false) {
+  if (table.redshiftDependence == false) {
         std::ifstream infile(filename.c_str());
         if (!infile.good())
             throw std::runtime_error("InverseCompton: could not open file " + filename);
    
         // clear previously loaded interaction rates
-        tabPhotonEnergy.clear();
-        tabProb.clear();
+        table.tabPhotonEnergy.clear();
+        table.tabProb.clear();
 
         while (infile.good()) {
             if (infile.peek() != '#') {
                 double a, b;
                 infile >> b >> a;
                 if (infile) {
-                    tabPhotonEnergy.push_back(a * eV);
-                    tabProb.push_back(b);
+                    table.tabPhotonEnergy.push_back(a * eV);
+                    table.tabProb.push_back(b);
                 }
             }
             infile.ignore(std::numeric_limits < std::streamsize > ::max(), '\n');
@@ -222,8 +282,8 @@ void InverseCompton::initTableBackgroundEnergy(std::string filename) {
             throw std::runtime_error("InverseCompton: could not open file " + filename);
   
         // clear previously loaded interaction rates
-        tabPhotonEnergy.clear();
-        tabProb.clear();
+        table.tabPhotonEnergy.clear();
+        table.tabProb.clear();
 
         // size of vector is predefined and depends on the model
         int nc; // number of columns (redshifts + one column for energy)
@@ -248,11 +308,11 @@ void InverseCompton::initTableBackgroundEnergy(std::string filename) {
         }
 
         for (int j=0; j<nl; j++) {
-            tabProb.push_back(entries[0][j]);
+            table.tabProb.push_back(entries[0][j]);
         }
         for (int i=1; i<=nc; i++){
             for (int j=0; j<nl; j++){
-                tabPhotonEnergy.push_back(entries[i][j] * eV);
+                table.tabPhotonEnergy.push_back(entries[i][j] * eV);
             }
         }
         infile.close();
@@ -280,10 +340,10 @@ double InverseCompton::energyFraction(double E, double z) const {
             return -1;
 
         double e = 0;
-        if (redshiftDependence == true)
-            e = interpolate2d(z, random.rand(), tabRedshift, tabProb, tabPhotonEnergy);
+        if (table.redshiftDependence == true)
+            e = tabulatedPhotonEnergy(random.rand(), z);
         else
-            e = (1 + z) * interpolate(random.rand(), tabProb, tabPhotonEnergy);
+            e = (1 + z) * tabulatedPhotonEnergy(random.rand(), z);
 
         double mu = random.randUniform(-1, 1);
         s = centerOfMassEnergy2(E, e, mu);
@@ -320,7 +380,11 @@ double InverseCompton::energyLossBelowThreshold(double E, double z, double step)
     Random &random = Random::instance();
 
     // drawing energy of background photon according to number density (integral)
-    double e = interpolate(random.rand(), tabProb, tabPhotonEnergy);
+    double e;
+    if (table.singlePrecision)
+        e = interpolate(random.rand(), table.tabProbF, table.tabPhotonEnergyF);
+    else
+        e = interpolate(random.rand(), table.tabProb, table.tabPhotonEnergy);
     e *= (1 + z);
     double ethr = Ethr * (1 + z);
 
@@ -350,22 +414,22 @@ double InverseCompton::lossLength(int id, double en, double z) const {
     if (std::abs(id) != 11)
         return std::numeric_limits<double>::max(); // no pair production by other particles
 
-    if (en < tabEnergy.front())
+    if (en < table.tableEnergyMin)
         return std::numeric_limits<double>::max(); // below energy threshold
 
     double rate;
-    if (redshiftDependence == false) {
+    if (table.redshiftDependence == false) {
         en *= (1 + z);
-        if (en < tabEnergy.back())
-            rate = interpolate(en, tabEnergy, tabRate); // interpolation
+        if (en < table.tableEnergyMax)
+            rate = tabulatedRate(en, z); // interpolation
         else
-            rate = tabRate.back() * pow(en / tabEnergy.back(), -0.6); // extrapolation
+            rate = table.tableRateLast * pow(en / table.tableEnergyMax, -0.6); // extrapolation
         rate *= pow(1 + z, 3);  
     } else {
-        if (en < tabEnergy.back())
-            rate = interpolate2d(z, en, tabRedshift, tabEnergy, tabRate); // interpolation
+        if (en < table.tableEnergyMax)
+            rate = tabulatedRate(en, z); // interpolation
         else
-            rate = tabRate.back() * pow(en / tabEnergy.back(), -0.6); // extrapolation
+            rate = table.tableRateLast * pow(en / table.tableEnergyMax, -0.6); // extrapolation
     }
 
     return 1. / rate;
@@ -380,9 +444,7 @@ void InverseCompton::process(Candidate *c) const {
         if (std::fabs(id) != 11) 
             return; // only photons allowed
 
-        double en = c->current.getEnergy();
-        double z = c->getRedshift();
-        double rate = 1 / lossLength(id, en, z);
+        double rate = interactionRate(c);
 
         Random &random = Random::instance();
         double randDistance = -log(random.rand()) / rate;
@@ -400,6 +462,17 @@ void InverseCompton::process(Candidate *c) const {
     } while (step > 0);
 }
 
+double InverseCompton::interactionRate(Candidate *c) const {
+    double rate;
+    if ((cacheTolerance > 0) and c->getCachedRate(this, cacheTolerance, rate))
+        return rate;
+
+    rate = 1. / lossLength(c->current.getId(), c->current.getEnergy(), c->getRedshift());
+    if (cacheTolerance > 0)
+        c->setCachedRate(this, rate);
+    return rate;
+}
+
 void InverseCompton::performInteraction(Candidate *candidate) const {
     
     double en = candidate->current.getEnergy();
@@ -0,0 +1,96 @@
+#include "grpropa/module/NeutralFastPath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace grpropa {
+
+NeutralFastPath::NeutralFastPath(bool redshift) {
+    setRedshift(redshift);
+}
+
+void NeutralFastPath::add(Observer *observer) {
+    observers.push_back(observer);
+}
+
+void NeutralFastPath::add(AbstractCondition *boundary) {
+    boundaries.push_back(boundary);
+}
+
+void NeutralFastPath::setPairProduction(PairProduction *pairProduction) {
+    if (not pairProduction->isEventDriven())
+        throw std::runtime_error("NeutralFastPath: pair production has to be event-driven, see PairProduction::setEventDriven");
+    this->pairProduction = pairProduction;
+}
+
+void NeutralFastPath::setRedshift(bool redshift) {
+    this->redshift = redshift;
+}
+
+double NeutralFastPath::distanceToTarget(const Vector3d &position, const Vector3d &direction) const {
+    double distance = std::numeric_limits<double>::infinity();
+    for (size_t i = 0; i < observers.size(); i++) {
+        double d = observers[i]->distanceToDetection(position, direction);
+        if (d < 0)
+            return -1;
+        distance = std::min(distance, d);
+    }
+    for (size_t i = 0; i < boundaries.size(); i++) {
+        double d = boundaries[i]->distanceToRejection(position, direction);
+        if (d < 0)
+            return -1;
+        distance = std::min(distance, d);
+    }
+    return distance;
+}
+
+void NeutralFastPath::process(Candidate *c) const {
+    if (not c->isActive())
+        return;
+    if (c->current.getCharge() != 0)
+        return;
+
+    Vector3d pos = c->current.getPosition();
+    Vector3d dir = c->current.getDirection();
+    double distance = distanceToTarget(pos, dir);
+    if ((distance <= 0) or (distance == std::numeric_limits<double>::infinity()))
+        return;
+
+    // step slightly across the surface, so that the crossing is seen by the observers and boundaries
+    double step = distance + 1e-9 * std::max(distance, pos.getR());
+
+    // photons: no jump without pair production, or if the sampled interaction point lies before the target
+    if (c->current.getId() == 22) {
+        if (not pairProduction)
+            return;
+        double interactionPoint;
+        if (not c->getScheduledInteraction(pairProduction, interactionPoint))
+            return;
+        if (interactionPoint - c->getTrajectoryLength() <= step)
+            return;
+    }
+
+    c->previous = c->current;
+    c->current.setPosition(pos + dir * step);
+    c->setCurrentStep(step);
+    if (redshift)
+        redshiftModule.process(c);
+
+    for (size_t i = 0; i < observers.size(); i++)
+        observers[i]->process(c);
+    for (size_t i = 0; i < boundaries.size(); i++)
+        boundaries[i]->process(c);
+}
+
+std::string NeutralFastPath::getDescription() const {
+    std::stringstream s;
+    s << "NeutralFastPath: " << observers.size() << " observers, " << boundaries.size() << " boundaries";
+    if (pairProduction)
+        s << ", limited by " << pairProduction->getDescription();
+    return s.str();
+}
+
+} // namespace grpropa
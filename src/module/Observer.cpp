@@ -2,6 +2,9 @@
 #include "grpropa/Units.h"
 #include "grpropa/Cosmology.h"
 
+#include <algorithm>
+#include <limits>
+
 namespace grpropa {
 
 // Observer -------------------------------------------------------------------
@@ -21,23 +24,33 @@ void Observer::onDetection(Module *action, bool clone_) {
 void Observer::process(Candidate *candidate) const {
     // loop over all features and have them check the particle
     DetectionState state = NOTHING;
+    double fraction = 1;
     for (int i = 0; i < features.size(); i++) {
         DetectionState s = features[i]->checkDetection(candidate);
         if (s == VETO)
             state = VETO;
         else if ((s == DETECTED) && (state != VETO))
             state = DETECTED;
+        if (s == DETECTED)
+            fraction = std::min(fraction, features[i]->crossingFraction(candidate));
     }
 
     if (state == DETECTED) {
+        // particles that stop here are moved back to where they were detected
+        if (makeInactive and (fraction < 1))
+            candidate->interpolateCurrentState(fraction);
+
         for (int i = 0; i < features.size(); i++) {
             features[i]->onDetection(candidate);
         }
 
         if (detectionAction.valid()) {
-            if (clone)
-                detectionAction->process(candidate->clone(false));
-            else
+            if (clone) {
+                ref_ptr<Candidate> c = candidate->clone(false);
+                if ((not makeInactive) and (fraction < 1))
+                    c->interpolateCurrentState(fraction);
+                detectionAction->process(c);
+            } else
                 detectionAction->process(candidate);
         }
 
@@ -71,6 +84,52 @@ void Observer::setDeactivateOnDetection(bool deactivate) {
     makeInactive = deactivate;
 }
 
+double Observer::distanceToDetection(const Vector3d &position, const Vector3d &direction) const {
+    double distance = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < features.size(); i++) {
+        double d = features[i]->distanceToDetection(position, direction);
+        if (d < 0)
+            return -1;
+        distance = std::min(distance, d);
+    }
+    return distance;
+}
+
+// distance along the ray to the next crossing of a sphere surface
+static double distanceToSphere(const Vector3d &position, const Vector3d &direction, const Vector3d &center, double radius) {
+    Vector3d r = position - center;
+    double b = r.dot(direction);
+    double c = r.getR2() - radius * radius;
+    double discriminant = b * b - c;
+    if (discriminant <= 0)
+        return std::numeric_limits<double>::infinity();
+    double root = sqrt(discriminant);
+    if (-b - root > 0)
+        return -b - root; // entry
+    if (-b + root > 0)
+        return -b + root; // exit
+    return std::numeric_limits<double>::infinity();
+}
+
+// fraction of the step from pos0 to pos1 at which a sphere surface is entered (entry = true) or exited,
+// -1 if the segment does not cross it that way
+static double sphereCrossing(const Vector3d &pos0, const Vector3d &pos1, const Vector3d &center, double radius, bool entry) {
+    Vector3d r = pos0 - center;
+    Vector3d s = pos1 - pos0;
+    double a = s.getR2();
+    if (a == 0)
+        return -1;
+    double b = r.dot(s);
+    double c = r.getR2() - radius * radius;
+    double discriminant = b * b - a * c;
+    if (discriminant < 0)
+        return -1;
+    double t = entry ? (-b - sqrt(discriminant)) / a : (-b + sqrt(discriminant)) / a;
+    if ((t < 0) or (t > 1))
+        return -1;
+    return t;
+}
+
 // ObserverFeature ------------------------------------------------------------
 DetectionState ObserverFeature::checkDetection(Candidate *candidate) const {
     return NOTHING;
@@ -83,6 +142,14 @@ std::string ObserverFeature::getDescription() const {
     return description;
 }
 
+double ObserverFeature::distanceToDetection(const Vector3d &position, const Vector3d &direction) const {
+    return -1;
+}
+
+double ObserverFeature::crossingFraction(const Candidate *candidate) const {
+    return 1;
+}
+
 // ObserverDetectAll ----------------------------------------------------------
 DetectionState ObserverDetectAll::checkDetection(Candidate *candidate) const {
     return DETECTED;
@@ -91,22 +158,16 @@ DetectionState ObserverDetectAll::checkDetection(Candidate *candidate) const {
 std::string ObserverDetectAll::getDescription() const {
 }
 
+double ObserverDetectAll::distanceToDetection(const Vector3d &position, const Vector3d &direction) const {
+    return 0;
+}
+
 // ObserverSmallSphere --------------------------------------------------------
 ObserverSmallSphere::ObserverSmallSphere(Vector3d center, double radius) :
         center(center), radius(radius) {
 }
 
 DetectionState ObserverSmallSphere::checkDetection(Candidate *candidate) const {
-    // current distance to observer sphere center
-    double d = (candidate->current.getPosition() - center).getR();
-
-    // conservatively limit next step to prevent overshooting
-    candidate->limitNextStep(fabs(d - radius));
-
-    // no detection if outside of observer sphere
-    if (d > radius)
-        return NOTHING;
-
     // previous distance to observer sphere center
     double dprev = (candidate->previous.getPosition() - center).getR();
 
@@ -114,8 +175,18 @@ DetectionState ObserverSmallSphere::checkDetection(Candidate *candidate) const {
     if (dprev <= radius)
         return NOTHING;
 
-    // else detection
-    return DETECTED;
+    // detection if the step ends inside the sphere or passes through it
+    double d = (candidate->current.getPosition() - center).getR();
+    if (d <= radius)
+        return DETECTED;
+    if (crossingFraction(candidate) < 1)
+        return DETECTED;
+    return NOTHING;
+}
+
+double ObserverSmallSphere::crossingFraction(const Candidate *candidate) const {
+    double t = sphereCrossing(candidate->previous.getPosition(), candidate->current.getPosition(), center, radius, true);
+    return (t < 0) ? 1 : t;
 }
 
 std::string ObserverSmallSphere::getDescription() const {
@@ -126,6 +197,10 @@ std::string ObserverSmallSphere::getDescription() const {
     return ss.str();
 }
 
+double ObserverSmallSphere::distanceToDetection(const Vector3d &position, const Vector3d &direction) const {
+    return distanceToSphere(position, direction, center, radius);
+}
+
 // ObserverTracking --------------------------------------------------------
 ObserverTracking::ObserverTracking(Vector3d center, double radius, double stepSize) :
         center(center), radius(radius), stepSize(stepSize) {
@@ -161,6 +236,13 @@ std::string ObserverTracking::getDescription() const {
     return ss.str();
 }
 
+double ObserverTracking::distanceToDetection(const Vector3d &position, const Vector3d &direction) const {
+    // particles are detected continuously inside the sphere
+    if ((position - center).getR() <= radius)
+        return 0;
+    return distanceToSphere(position, direction, center, radius);
+}
+
 // ObserverLargeSphere --------------------------------------------------------
 ObserverLargeSphere::ObserverLargeSphere(Vector3d center, double radius) :
         center(center), radius(radius) {
@@ -170,9 +252,6 @@ DetectionState ObserverLargeSphere::checkDetection(Candidate *candidate) const {
     // current distance to observer sphere center
     double d = (candidate->current.getPosition() - center).getR();
 
-    // conservatively limit next step size to prevent overshooting
-    candidate->limitNextStep(fabs(radius - d));
-
     // no detection if inside observer sphere
     if (d < radius)
         return NOTHING;
@@ -188,6 +267,11 @@ DetectionState ObserverLargeSphere::checkDetection(Candidate *candidate) const {
     return DETECTED;
 }
 
+double ObserverLargeSphere::crossingFraction(const Candidate *candidate) const {
+    double t = sphereCrossing(candidate->previous.getPosition(), candidate->current.getPosition(), center, radius, false);
+    return (t < 0) ? 1 : t;
+}
+
 std::string ObserverLargeSphere::getDescription() const {
     std::stringstream ss;
     ss << "ObserverLargeSphere: ";
@@ -196,20 +280,36 @@ std::string ObserverLargeSphere::getDescription() const {
     return ss.str();
 }
 
+double ObserverLargeSphere::distanceToDetection(const Vector3d &position, const Vector3d &direction) const {
+    return distanceToSphere(position, direction, center, radius);
+}
+
 // ObserverPoint --------------------------------------------------------------
 DetectionState ObserverPoint::checkDetection(Candidate *candidate) const {
     double x = candidate->current.getPosition().x;
-    if (x > 0) {
-        candidate->limitNextStep(x);
+    if (x > 0)
         return NOTHING;
-    }
     return DETECTED;
 }
 
+double ObserverPoint::crossingFraction(const Candidate *candidate) const {
+    double x0 = candidate->previous.getPosition().x;
+    double x = candidate->current.getPosition().x;
+    if ((x0 <= 0) or (x > 0))
+        return 1;
+    return x0 / (x0 - x);
+}
+
 std::string ObserverPoint::getDescription() const {
     return "ObserverPoint: observer at x = 0";
 }
 
+double ObserverPoint::distanceToDetection(const Vector3d &position, const Vector3d &direction) const {
+    if ((position.x <= 0) or (direction.x >= 0))
+        return std::numeric_limits<double>::infinity();
+    return position.x / -direction.x;
+}
+
 // ObserverRedshiftWindow -----------------------------------------------------
 ObserverRedshiftWindow::ObserverRedshiftWindow(double zmin, double zmax) :
         zmin(zmin), zmax(zmax) {
@@ -230,6 +330,10 @@ std::string ObserverRedshiftWindow::getDescription() const {
     return ss.str();
 }
 
+double ObserverRedshiftWindow::distanceToDetection(const Vector3d &position, const Vector3d &direction) const {
+    return std::numeric_limits<double>::infinity(); // vetos do not detect
+}
+
 // ObserverInactiveVeto -------------------------------------------------------
 DetectionState ObserverInactiveVeto::checkDetection(Candidate *c) const {
     if (not(c->isActive()))
@@ -241,6 +345,10 @@ std::string ObserverInactiveVeto::getDescription() const {
     return "ObserverInactiveVeto";
 }
 
+double ObserverInactiveVeto::distanceToDetection(const Vector3d &position, const Vector3d &direction) const {
+    return std::numeric_limits<double>::infinity(); // vetos do not detect
+}
+
 // ObserverNeutrinoVeto -------------------------------------------------------
 DetectionState ObserverNeutrinoVeto::checkDetection(Candidate *c) const {
     int id = abs(c->current.getId());
@@ -253,6 +361,10 @@ std::string ObserverNeutrinoVeto::getDescription() const {
     return "ObserverNeutrinoVeto";
 }
 
+double ObserverNeutrinoVeto::distanceToDetection(const Vector3d &position, const Vector3d &direction) const {
+    return std::numeric_limits<double>::infinity(); // vetos do not detect
+}
+
 // ObserverPhotonVeto ---------------------------------------------------------
 DetectionState ObserverPhotonVeto::checkDetection(Candidate *c) const {
     if (c->current.getId() == 22)
@@ -264,6 +376,10 @@ std::string ObserverPhotonVeto::getDescription() const {
     return "ObserverPhotonVeto";
 }
 
+double ObserverPhotonVeto::distanceToDetection(const Vector3d &position, const Vector3d &direction) const {
+    return std::numeric_limits<double>::infinity(); // vetos do not detect
+}
+
 // ObserverElectronVeto ---------------------------------------------------------
 DetectionState ObserverElectronVeto::checkDetection(Candidate *c) const {
     if (abs(c->current.getId()) == 11)
@@ -275,4 +391,8 @@ std::string ObserverElectronVeto::getDescription() const {
     return "ObserverElectronVeto";
 }
 
+double ObserverElectronVeto::distanceToDetection(const Vector3d &position, const Vector3d &direction) const {
+    return std::numeric_limits<double>::infinity(); // vetos do not detect
+}
+
 }// namespace
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "grpropa/module/PairProduction.h"
 #include "grpropa/Random.h"
 #include "grpropa/Units.h"
+#include "grpropa/Cosmology.h"
 
 #include <fstream>
 #include <limits>
@@ -9,73 +10,75 @@
 namespace grpropa {
 
 PairProduction::PairProduction(PhotonField photonField, double thinning, double limit, double nMaxIterations) {
+    eventDriven = false;
     setPhotonField(photonField);
     setThinning(thinning);
     setLimit(limit);
     setMaxNumberOfIterations(nMaxIterations);
+    setCacheTolerance(1e-3);
 }
 
 void PairProduction::setPhotonField(PhotonField photonField) {
     this->photonField = photonField;
     switch (photonField) {
     case CMB:
-        redshiftDependence = false;
+        table.redshiftDependence = false;
         setDescription("Pair Production: CMB");
         initRate(getDataPath("PP-CMB.txt"));
         initTableBackgroundEnergy(getDataPath("photonProbabilities-CMB.txt"));
         break;
     case EBL:  // default: Gilmore '12 IRB model
     case EBL_Gilmore12:
-        redshiftDependence = true;
+        table.redshiftDependence = true;
         setDescription("Pair  Production: EBL Gilmore et al. 2012");
         initRate(getDataPath("PP-EBL_Gilmore12.txt"));
         initTableBackgroundEnergy(getDataPath("photonProbabilities-EBL_Gilmore12.txt"));
         break;
     case EBL_Dominguez11:
-        redshiftDependence = true;
+        table.redshiftDependence = true;
         setDescription("Pair Production: EBL Dominguez et al. 2011");
         initRate(getDataPath("PP-EBL_Dominguez11.txt"));
         initTableBackgroundEnergy(getDataPath("photonProbabilities-EBL_Dominguez11.txt"));
         break;
     case EBL_Dominguez11_UL:
-        redshiftDependence = true;
+        table.redshiftDependence = true;
         setDescription("Pair Production: EBL Dominguez et al. 2011 (upper limit)");
         initRate(getDataPath("PP-EBL_Dominguez11_UL.txt"));
         initTableBackgroundEnergy(getDataPath("photonProbabilities-EBL_Dominguez11_UL.txt"));
         break;
     case EBL_Dominguez11_LL:
-        redshiftDependence = true;
+        table.redshiftDependence = true;
         setDescription("Pair Production: EBL Dominguez et al. 2011 (lower limit)");
         initRate(getDataPath("PP-EBL_Dominguez11_LL.txt"));
         initTableBackgroundEnergy(getDataPath("photonProbabilities-EBL_Dominguez11_LL.txt"));
         break;
     case EBL_Finke10:
-        redshiftDependence = true;
+        table.redshiftDependence = true;
         setDescription("Pair Production: EBL Finke et al. 2010");
         initRate(getDataPath("PP-EBL_Finke10.txt"));
         initTableBackgroundEnergy(getDataPath("photonProbabilities-EBL_Finke10.txt"));
         break;
     case EBL_Kneiske10:
-        redshiftDependence = true;
+        table.redshiftDependence = true;
         setDescription("Pair Production: EBL Kneiske & Dole 2010 (lower limit)");
         initRate(getDataPath("PP-EBL_Kneiske10.txt"));
         initTableBackgroundEnergy(getDataPath("photonProbabilities-EBL_Kneiske10.txt"));
         break;
     case EBL_Franceschini08:
-        redshiftDependence = true;
+        table.redshiftDependence = true;
         setDescription("Pair Production: EBL Franceschini et al. 2008");
         initRate(getDataPath("PP-EBL_Franceschini08.txt"));
         initTableBackgroundEnergy(getDataPath("photonProbabilities-EBL_Franceschini08.txt"));
         break;
     case CRB:
     case CRB_Protheroe96:
-        redshiftDependence = false;
+        table.redshiftDependence = false;
         setDescription("Pair Production: CRB Protheroe & Biermann 1996");
         initRate(getDataPath("PP-CRB_Protheroe96.txt"));
         initTableBackgroundEnergy(getDataPath("photonProbabilities-CRB_Protheroe96.txt"));
         break;
     case CRB_ARCADE2:
-        redshiftDependence = false;
+        table.redshiftDependence = false;
         setDescription("Pair Production: CRB ARCADE2 2010");
         initRate(getDataPath("PP-CRB_ARCADE2.txt"));
         initTableBackgroundEnergy(getDataPath("photonProbabilities-CRB_ARCADE2.txt"));
@@ -83,6 +86,55 @@ void PairProduction::setPhotonField(PhotonField photonField) {
     default:
         throw std::runtime_error("PairProduction: unknown photon background");
     }
+    table.customTables = 0;
+    applyTableResolution();
+}
+
+void PairProduction::setCustomPhotonField(ref_ptr<CustomPhotonField> field) {
+    setInteractionTables(pairProductionTables(field));
+    setDescription("Pair production: custom photon field");
+}
+
+void PairProduction::setInteractionTables(ref_ptr<InteractionTables> tables) {
+    table.setInteractionTables(tables, "PairProduction");
+    applyTableResolution();
+    setDescription("Pair production: interaction tables");
+}
+
+void PairProduction::setTableResolution(size_t nEnergies, size_t nProbabilities, bool singlePrecision) {
+    table.nTableEnergies = nEnergies;
+    table.nTableProbabilities = nProbabilities;
+    table.singlePrecision = singlePrecision;
+
+    // reload the original tables
+    std::string description = getDescription();
+    if (table.customTables)
+        setInteractionTables(table.customTables);
+    else
+        setPhotonField(photonField);
+    setDescription(description);
+}
+
+double PairProduction::getRateTableError() const {
+    return table.rateTableError;
+}
+
+double PairProduction::getPhotonTableError() const {
+    return table.photonTableError;
+}
+
+void PairProduction::applyTableResolution() {
+    table.applyTableResolution();
+    if (eventDriven)
+        initOpticalDepth();
+}
+
+double PairProduction::tabulatedRate(double E, double z) const {
+    return table.rate(E, z);
+}
+
+double PairProduction::tabulatedPhotonEnergy(double p, double z) const {
+    return table.photonEnergy(p, z);
 }
 
 void PairProduction::setLimit(double limit) {
@@ -97,24 +149,163 @@ void PairProduction::setMaxNumberOfIterations(double a) {
     this->nMaxIterations = a;
 }
 
+void PairProduction::setEventDriven(bool eventDriven, double zmax) {
+    this->eventDriven = eventDriven;
+    this->depthRedshiftMax = zmax;
+    if (eventDriven)
+        initOpticalDepth();
+    else
+        std::vector<double>().swap(tabOpticalDepth);
+}
+
+bool PairProduction::isEventDriven() const {
+    return eventDriven;
+}
+
+void PairProduction::initOpticalDepth() {
+    // grid in eps = E / (1 + z), logarithmic, and in ln(1 + z), uniform
+    nDepthEnergies = 400;
+    nDepthRedshifts = 400;
+    depthEnergyMin = table.tableEnergyMin / (1 + depthRedshiftMax);
+    depthEnergyMax = table.tableEnergyMax;
+    double dle = log(depthEnergyMax / depthEnergyMin) / (nDepthEnergies - 1);
+    double dlz = log(1 + depthRedshiftMax) / (nDepthRedshifts - 1);
+
+    // d tau / dz = rate(eps (1 + z), z) * c / H(z), integrated from z = 0 with the trapezoidal rule
+    tabOpticalDepth.resize(nDepthEnergies * nDepthRedshifts);
+#pragma omp parallel for
+    for (int i = 0; i < (int) nDepthEnergies; i++) {
+        double eps = depthEnergyMin * exp(i * dle);
+        double *depth = &tabOpticalDepth[i * nDepthRedshifts];
+        depth[0] = 0;
+        double zPrev = 0;
+        double fPrev = c_light / hubbleRate(0) / lossLength(22, eps, 0);
+        for (size_t k = 1; k < nDepthRedshifts; k++) {
+            double z = expm1(k * dlz);
+            double f = c_light / hubbleRate(z) / lossLength(22, eps * (1 + z), z);
+            depth[k] = depth[k - 1] + (f + fPrev) / 2 * (z - zPrev);
+            zPrev = z;
+            fPrev = f;
+        }
+    }
+}
+
+double PairProduction::cumulativeOpticalDepth(double eps, double z) const {
+    double dle = log(depthEnergyMax / depthEnergyMin) / (nDepthEnergies - 1);
+    double dlz = log(1 + depthRedshiftMax) / (nDepthRedshifts - 1);
+    double x = log(eps / depthEnergyMin) / dle;
+    double y = log1p(z) / dlz;
+    size_t i = std::min(size_t(x), nDepthEnergies - 2);
+    size_t k = std::min(size_t(y), nDepthRedshifts - 2);
+    double w = x - i;
+    double v = y - k;
+    const double *T0 = &tabOpticalDepth[i * nDepthRedshifts];
+    const double *T1 = &tabOpticalDepth[(i + 1) * nDepthRedshifts];
+    return (1 - w) * ((1 - v) * T0[k] + v * T0[k + 1]) + w * ((1 - v) * T1[k] + v * T1[k + 1]);
+}
+
+double PairProduction::opticalDepth(double E, double z, double distance) const {
+    if (tabOpticalDepth.size() == 0)
+        throw std::runtime_error("PairProduction: optical depth table not initialized, see setEventDriven");
+    double eps = E / (1 + z);
+    double Dc = (z > 0) ? redshift2ComovingDistance(z) : 0;
+    if (distance >= Dc)
+        return cumulativeOpticalDepth(eps, z) + (distance - Dc) / lossLength(22, eps, 0);
+    double z1 = redshiftAfterComovingDistance(z, distance);
+    return cumulativeOpticalDepth(eps, z) - cumulativeOpticalDepth(eps, z1);
+}
+
+double PairProduction::interactionDistance(double E, double z, double tau) const {
+    if (tabOpticalDepth.size() == 0)
+        throw std::runtime_error("PairProduction: optical depth table not initialized, see setEventDriven");
+    double eps = E / (1 + z);
+    double Dc = (z > 0) ? redshift2ComovingDistance(z) : 0;
+    double target = cumulativeOpticalDepth(eps, z) - tau;
+
+    // the interaction happens after z = 0 is reached, with constant rate from there on
+    if (target <= 0)
+        return Dc - target * lossLength(22, eps, 0);
+
+    // invert the optical depth, which is monotonic in z, by bisection over the table
+    double dle = log(depthEnergyMax / depthEnergyMin) / (nDepthEnergies - 1);
+    double dlz = log(1 + depthRedshiftMax) / (nDepthRedshifts - 1);
+    double x = log(eps / depthEnergyMin) / dle;
+    size_t i = std::min(size_t(x), nDepthEnergies - 2);
+    double w = x - i;
+    const double *T0 = &tabOpticalDepth[i * nDepthRedshifts];
+    const double *T1 = &tabOpticalDepth[(i + 1) * nDepthRedshifts];
+
+    size_t lo = 0;
+    size_t hi = std::min(size_t(log1p(z) / dlz) + 1, nDepthRedshifts - 1);
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if ((1 - w) * T0[mid] + w * T1[mid] > target)
+            hi = mid;
+        else
+            lo = mid;
+    }
+    double Tlo = (1 - w) * T0[lo] + w * T1[lo];
+    double Thi = (1 - w) * T0[hi] + w * T1[hi];
+    double y = lo + ((Thi > Tlo) ? (target - Tlo) / (Thi - Tlo) : 0);
+    double zInteraction = std::min(expm1(y * dlz), z);
+    return Dc - redshift2ComovingDistance(zInteraction);
+}
+
+bool PairProduction::processEventDriven(Candidate *c) const {
+    if (c->current.getId() != 22)
+        return true; // only photons allowed
+
+    double z = c->getRedshift();
+    double eps = c->current.getEnergy() / (1 + z);
+    if ((z > depthRedshiftMax) or (eps < depthEnergyMin) or (eps > depthEnergyMax))
+        return false; // outside of the table, use the stepwise algorithm
+
+    // sample the interaction point once
+    double interactionPoint;
+    if (not c->getScheduledInteraction(this, interactionPoint)) {
+        Random &random = Random::instance();
+        interactionPoint = c->getTrajectoryLength() + interactionDistance(c->current.getEnergy(), z, -log(random.rand()));
+        c->setScheduledInteraction(this, interactionPoint);
+    }
+
+    double remaining = interactionPoint - c->getTrajectoryLength();
+    if (remaining <= 1e-9 * c->getTrajectoryLength()) {
+        c->clearScheduledInteraction(this);
+        performInteraction(c);
+        return true;
+    }
+
+    // step exactly to the interaction point
+    c->limitNextStep(remaining);
+    return true;
+}
+
+void PairProduction::setCacheTolerance(double tolerance) {
+    this->cacheTolerance = tolerance;
+}
+
+double PairProduction::getCacheTolerance() const {
+    return cacheTolerance;
+}
+
 void PairProduction::initRate(std::string filename) {
 
-    if (redshiftDependence == false) {
+    if (table.redshiftDependence == false) {
         std::ifstream infile(filename.c_str());
         if (!infile.good())
             throw std::runtime_error("PairProduction: could not open file " + filename);
    
         // clear previously loaded interaction rates
-        tabEnergy.clear();
-        tabRate.clear();
+        table.tabEnergy.clear();
+        table.tabRate.clear();
 
         while (infile.good()) {
             if (infile.peek() != '#') {
                 double a, b;
                 infile >> a >> b;
                 if (infile) {
-                    tabEnergy.push_back(a * eV);
-                    tabRate.push_back(b / Mpc);
+                    table.tabEnergy.push_back(a * eV);
+                    table.tabRate.push_back(b / Mpc);
                 }
             }
             infile.ignore(std::numeric_limits < std::streamsize > ::max(), '\n');
@@ -126,9 +317,9 @@ void PairProduction::initRate(std::string filename) {
             throw std::runtime_error("PairProduction: could not open file " + filename);
   
         // clear previously loaded interaction rates
-        tabEnergy.clear();
-        tabRate.clear();
-        tabRedshift.clear();
+        table.tabEnergy.clear();
+        table.tabRate.clear();
+        table.tabRedshift.clear();
 
         // size of vector is predefined and depends on the model
         int nc; // number of columns (redshifts + one column for energy)
@@ -138,31 +329,31 @@ void PairProduction::initRate(std::string filename) {
             nc = 33;
             double redshifts[] = {0.00, 0.01, 0.02, 0.03, 0.04, 0.05, 0.07, 0.09, 0.10, 0.15, 0.20, 0.25, 0.30, 0.35, 0.40, 0.45, 0.50, 0.60, 0.70, 0.80, 0.90, 1.00, 1.20, 1.40, 1.60, 1.80, 2.00, 2.50, 3.00, 3.50, 4.00, 4.50, 4.99};
             for (int k=0; k<nc; k++) 
-                tabRedshift.push_back(redshifts[k]);
+                table.tabRedshift.push_back(redshifts[k]);
         }
         else if (photonField == EBL_Gilmore12) {
             nc = 20;
             double redshifts[] = {0, 0.015, 0.025, 0.044, 0.05, 0.2, 0.4, 0.5, 0.6, 0.8, 1.0, 1.25, 1.5, 2.0, 2.5, 3.0, 4.0, 5.0, 6.0, 7.0};
             for (int k=0; k<nc; k++) 
-                tabRedshift.push_back(redshifts[k]);
+                table.tabRedshift.push_back(redshifts[k]);
         }
         else if (photonField == EBL_Dominguez11 || photonField == EBL_Dominguez11_UL || photonField == EBL_Dominguez11_LL) {
             nc = 20;
             double redshifts[] = {0, 0.01, 0.03, 0.05, 0.1, 0.2, 0.3, 0.4, 0.5, 0.6, 0.8, 1.0, 1.25, 1.5, 2.0, 2.5, 3.0, 3.9};
             for (int k=0; k<nc; k++) 
-                tabRedshift.push_back(redshifts[k]);
+                table.tabRedshift.push_back(redshifts[k]);
         }
         else if (photonField == EBL_Kneiske10) {
             nc = 5;
             double redshifts[] = {0.0, 0.1, 0.3, 0.8, 2.0};
             for (int k=0; k<nc; k++) 
-                tabRedshift.push_back(redshifts[k]);
+                table.tabRedshift.push_back(redshifts[k]);
         }
         else if (photonField == EBL_Franceschini08) {
             nc = 11;
             double redshifts[] = {0.0, 0.2, 0.4, 0.6, 0.8, 1.0, 1.2, 1.4, 1.6, 1.8, 2.0};
             for (int k=0; k<nc; k++) 
-                tabRedshift.push_back(redshifts[k]);
+                table.tabRedshift.push_back(redshifts[k]);
         }
         else { 
             throw std::runtime_error("EBL model not defined for redshift-dependent treatment (or not defined at all).");
@@ -180,32 +371,32 @@ void PairProduction::initRate(std::string filename) {
         }
 
         for (int j=0; j<nl; j++) 
-            tabEnergy.push_back(entries[0][j] * eV);
+            table.tabEnergy.push_back(entries[0][j] * eV);
         for (int i=1; i<=nc; i++)
             for (int j=0; j<nl; j++)
-                tabRate.push_back(entries[i][j] / Mpc);
+                table.tabRate.push_back(entries[i][j] / Mpc);
 
         infile.close();
     } // conditional: redshift dependent
 }
 
 void PairProduction::initTableBackgroundEnergy(std::string filename) {
-   if (redshiftDependence == false) {
+   if (table.redshiftDependence == false) {
         std::ifstream infile(filename.c_str());
         if (!infile.good())
             throw std::runtime_error("PairProduction: could not open file " + filename);
    
         // clear previously loaded interaction rates
-        tabPhotonEnergy.clear();
-        tabProb.clear();
+        table.tabPhotonEnergy.clear();
+        table.tabProb.clear();
 
         while (infile.good()) {
             if (infile.peek() != '#') {
                 double a, b;
                 infile >> b >> a;
                 if (infile) {
-                    tabPhotonEnergy.push_back(a * eV);
-                    tabProb.push_back(b);
+                    table.tabPhotonEnergy.push_back(a * eV);
+                    table.tabProb.push_back(b);
                 }
             }
             infile.ignore(std::numeric_limits < std::streamsize > ::max(), '\n');
@@ -217,8 +408,8 @@ void PairProduction::initTableBackgroundEnergy(std::string filename) {
             throw std::runtime_error("PairProduction: could not open file " + filename);
   
         // clear previously loaded interaction rates
-        tabPhotonEnergy.clear();
-        tabProb.clear();
+        table.tabPhotonEnergy.clear();
+        table.tabProb.clear();
 
         // size of vector is predefined and depends on the model
         int nc; // number of columns (redshifts + one column for energy)
@@ -243,11 +434,11 @@ void PairProduction::initTableBackgroundEnergy(std::string filename) {
         }
 
         for (int j=0; j<nl; j++) {
-            tabProb.push_back(entries[0][j]);
+            table.tabProb.push_back(entries[0][j]);
         }
         for (int i=1; i<=nc; i++){
             for (int j=0; j<nl; j++){
-                tabPhotonEnergy.push_back(entries[i][j] * eV);
+                table.tabPhotonEnergy.push_back(entries[i][j] * eV);
             }
         }
         infile.close();
@@ -274,10 +465,10 @@ double PairProduction::energyFraction(double E, double z) const {
             return -1;
 
         double e;    
-        if (redshiftDependence == true)
-            e = interpolate2d(z, random.rand(), tabRedshift, tabProb, tabPhotonEnergy);
+        if (table.redshiftDependence == true)
+            e = tabulatedPhotonEnergy(random.rand(), z);
         else
-            e = (1 + z) * interpolate(random.rand(), tabProb, tabPhotonEnergy);
+            e = (1 + z) * tabulatedPhotonEnergy(random.rand(), z);
 
         // kinematics
         double mu = random.randUniform(-1, 1);  
@@ -313,28 +504,30 @@ double PairProduction::lossLength(int id, double en, double z) const {
     if (id != 22)
         return std::numeric_limits<double>::max(); // no pair production by other particles
 
-    if (en < tabEnergy.front())
+    if (en < table.tableEnergyMin)
         return std::numeric_limits<double>::max(); // below energy threshold
 
     double rate;
-    if (redshiftDependence == false) {
+    if (table.redshiftDependence == false) {
         en *= (1 + z);
-        if (en < tabEnergy.back())
-            rate = interpolate(en, tabEnergy, tabRate); // interpolation
+        if (en < table.tableEnergyMax)
+            rate = tabulatedRate(en, z); // interpolation
         else
-            rate = tabRate.back() * pow(en / tabEnergy.back(), -0.6); // extrapolation
+            rate = table.tableRateLast * pow(en / table.tableEnergyMax, -0.6); // extrapolation
         rate *= pow(1 + z, 3);  
     } else {
-        if (en < tabEnergy.back())
-            rate = interpolate2d(z, en, tabRedshift, tabEnergy, tabRate); // interpolation
+        if (en < table.tableEnergyMax)
+            rate = tabulatedRate(en, z); // interpolation
         else
-            rate = tabRate.back() * pow(en / tabEnergy.back(), -0.6); // extrapolation
+            rate = table.tableRateLast * pow(en / table.tableEnergyMax, -0.6); // extrapolation
     }
 
     return 1. / rate;
 }
 
 void PairProduction::process(Candidate *c) const {
+    if (eventDriven and processEventDriven(c))
+        return;
 
     // execute the loop at least once for limiting the next step
     double step = c->getCurrentStep();
@@ -343,9 +536,7 @@ void PairProduction::process(Candidate *c) const {
         if (id != 22) 
             return; // only photons allowed
 
-        double en = c->current.getEnergy();
-        double z = c->getRedshift();
-        double rate = 1 / lossLength(id, en, z);
+        double rate = interactionRate(c);
 
         Random &random = Random::instance();
         double randDistance = -log(random.rand()) / rate;
@@ -363,6 +554,17 @@ void PairProduction::process(Candidate *c) const {
     } while (step > 0);
 }
 
+double PairProduction::interactionRate(Candidate *c) const {
+    double rate;
+    if ((cacheTolerance > 0) and c->getCachedRate(this, cacheTolerance, rate))
+        return rate;
+
+    rate = 1. / lossLength(c->current.getId(), c->current.getEnergy(), c->getRedshift());
+    if (cacheTolerance > 0)
+        c->setCachedRate(this, rate);
+    return rate;
+}
+
 void PairProduction::performInteraction(Candidate *candidate) const {
     
     double en = candidate->current.getEnergy();
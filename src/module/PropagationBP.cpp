@@ -0,0 +1,122 @@
+#include "grpropa/module/PropagationBP.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace grpropa {
+
+PropagationBP::PropagationBP(ref_ptr<MagneticField> field, double tolerance, double minStep, double maxStep) :
+        minStep(0) {
+    setField(field);
+    setTolerance(tolerance);
+    setMaximumStep(maxStep);
+    setMinimumStep(minStep);
+}
+
+double PropagationBP::tryStep(Vector3d &x, Vector3d &u, double step, const ParticleState &p) const {
+    // drift to the midpoint
+    Vector3d xMid = x + u * (step / 2);
+
+    // rotate the direction, du/ds = q*c/E * (u x B)
+    Vector3d t = field->getField(xMid) * (p.getCharge() * c_light / p.getEnergy() * step / 2);
+    Vector3d uPrime = u + u.cross(t);
+    Vector3d s = t * (2 / (1 + t.getR2()));
+    u = u + uPrime.cross(s);
+
+    // drift to the end point
+    x = xMid + u * (step / 2);
+
+    // rotation angle, 2 atan(|t|)
+    return 2 * atan(t.getR());
+}
+
+void PropagationBP::process(Candidate *candidate) const {
+    // save the new previous particle state
+    ParticleState &current = candidate->current;
+    candidate->previous = current;
+
+    double step = clip(candidate->getNextStep(), minStep, maxStep);
+
+    // rectilinear propagation for neutral particles
+    if (current.getCharge() == 0) {
+        Vector3d pos = current.getPosition();
+        Vector3d dir = current.getDirection();
+        current.setPosition(pos + dir * step);
+        candidate->setCurrentStep(step);
+        candidate->setNextStep(maxStep);
+        return;
+    }
+
+    // largest rotation angle per step with a phase error theta^3 / 12 below the tolerance
+    double thetaMax = pow(12 * tolerance, 1. / 3.);
+
+    Vector3d x, u;
+    double theta;
+    while (true) {
+        x = current.getPosition();
+        u = current.getDirection();
+        theta = tryStep(x, u, step, current);
+        if ((theta <= thetaMax) or (step <= minStep))
+            break;
+        // repeat with the step size matching the field at the midpoint
+        step = std::max(step * thetaMax / theta * 0.95, minStep);
+    }
+
+    // propose the next step from the field of this one
+    double next = (theta > 0) ? step * thetaMax / theta : maxStep;
+    next = std::min(next, 5 * step);
+
+    current.setPosition(x);
+    current.setDirection(u);
+    candidate->setCurrentStep(step);
+    candidate->setNextStep(next);
+}
+
+void PropagationBP::setField(ref_ptr<MagneticField> f) {
+    field = f;
+}
+
+void PropagationBP::setTolerance(double tol) {
+    if ((tol > 1) or (tol <= 0))
+        throw std::runtime_error("PropagationBP: target error not in range 0-1");
+    tolerance = tol;
+}
+
+void PropagationBP::setMinimumStep(double min) {
+    if (min < 0)
+        throw std::runtime_error("PropagationBP: minStep < 0 ");
+    if (min > maxStep)
+        throw std::runtime_error("PropagationBP: minStep > maxStep");
+    minStep = min;
+}
+
+void PropagationBP::setMaximumStep(double max) {
+    if (max < minStep)
+        throw std::runtime_error("PropagationBP: maxStep < minStep");
+    maxStep = max;
+}
+
+double PropagationBP::getTolerance() const {
+    return tolerance;
+}
+
+double PropagationBP::getMinimumStep() const {
+    return minStep;
+}
+
+double PropagationBP::getMaximumStep() const {
+    return maxStep;
+}
+
+std::string PropagationBP::getDescription() const {
+    std::stringstream s;
+    s << "Propagation in magnetic fields using the Boris push.";
+    s << " Target error: " << tolerance;
+    s << ", Minimum Step: " << minStep / kpc << " kpc";
+    s << ", Maximum Step: " << maxStep / kpc << " kpc";
+    return s.str();
+}
+
+} // namespace grpropa
@@ -3,49 +3,54 @@
 #include <limits>
 #include <sstream>
 #include <stdexcept>
-#include <vector>
 
 namespace grpropa {
 
 // Cash-Karp coefficients
-const double cash_karp_a[] = { 0., 0., 0., 0., 0., 0., 1. / 5., 0., 0., 0., 0., 0., 3. / 40., 9. / 40., 0., 0., 0., 0., 3. / 10., -9. / 10., 6. / 5., 0., 0., 0., -11. / 54., 5. / 2., -70. / 27., 35. / 27., 0., 0., 1631. / 55296., 175. / 512., 575. / 13824., 44275. / 110592., 253. / 4096., 0. };
+static const double cash_karp_a[6][5] = {
+    { 0., 0., 0., 0., 0. },
+    { 1. / 5., 0., 0., 0., 0. },
+    { 3. / 40., 9. / 40., 0., 0., 0. },
+    { 3. / 10., -9. / 10., 6. / 5., 0., 0. },
+    { -11. / 54., 5. / 2., -70. / 27., 35. / 27., 0. },
+    { 1631. / 55296., 175. / 512., 575. / 13824., 44275. / 110592., 253. / 4096. } };
 
-const double cash_karp_b[] = { 37. / 378., 0, 250. / 621., 125. / 594., 0., 512. / 1771. };
+static const double cash_karp_b[6] = { 37. / 378., 0, 250. / 621., 125. / 594., 0., 512. / 1771. };
 
-const double cash_karp_bs[] = { 2825. / 27648., 0., 18575. / 48384., 13525. / 55296., 277. / 14336., 1. / 4. };
+static const double cash_karp_bs[6] = { 2825. / 27648., 0., 18575. / 48384., 13525. / 55296., 277. / 14336., 1. / 4. };
 
 void PropagationCK::tryStep(const Y &y, Y &out, Y &error, double h, ParticleState &particle) const {
-    std::vector<Y> k;
-    k.reserve(6);
+    tryStep(y, dYdt(y, particle), out, error, h, particle);
+}
+
+void PropagationCK::tryStep(const Y &y, const Y &dydt, Y &out, Y &error, double h, ParticleState &particle) const {
+    Y k[6];
+    k[0] = dydt;
 
     out = y;
     error = Y(0);
 
     // calculate the sum of b_i * k_i
     for (size_t i = 0; i < 6; i++) {
+        if (i > 0) {
+            Y y_n = y;
+            for (size_t j = 0; j < i; j++)
+                y_n += k[j] * (cash_karp_a[i][j] * h);
+            k[i] = dYdt(y_n, particle);
+        }
 
-        Y y_n = y;
-        for (size_t j = 0; j < i; j++)
-            y_n += k[j] * a[i * 6 + j] * h;
-
-        // update k_i
-        k[i] = dYdt(y_n, particle);
-
-        out += k[i] * b[i] * h;
-        error += k[i] * (b[i] - bs[i]) * h;
+        out += k[i] * (cash_karp_b[i] * h);
+        error += k[i] * ((cash_karp_b[i] - cash_karp_bs[i]) * h);
     }
 }
 
 PropagationCK::Y PropagationCK::dYdt(const Y &y, ParticleState &p) const {
+    return dYdt(y, p, field->getField(y.x));
+}
+
+PropagationCK::Y PropagationCK::dYdt(const Y &y, ParticleState &p, const Vector3d &B) const {
     // normalize direction vector to prevent numerical losses
     Vector3d velocity = y.u.getUnitVector() * c_light;
-    Vector3d B(0, 0, 0);
-    try {
-        B = field->getField(y.x);
-    } catch (std::exception &e) {
-        std::cerr << "PropagationCK: Exception in getField." << std::endl;
-        std::cerr << e.what() << std::endl;
-    }
     // Lorentz force: du/dt = q*c/E * (v x B)
     Vector3d dudt = p.getCharge() * c_light / p.getEnergy() * velocity.cross(B);
     return Y(velocity, dudt);
@@ -58,11 +63,6 @@ PropagationCK::PropagationCK(ref_ptr<MagneticField> field, double tolerance, dou
     setMaximumStep(maxStep);
     setMinimumStep(minStep);
     nMaxIterations = nMax;
-
-    // load Cash-Karp coefficients
-    a.assign(cash_karp_a, cash_karp_a + 36);
-    b.assign(cash_karp_b, cash_karp_b + 6);
-    bs.assign(cash_karp_bs, cash_karp_bs + 6);
 }
 
 void PropagationCK::process(Candidate *candidate) const {
@@ -83,6 +83,12 @@ void PropagationCK::process(Candidate *candidate) const {
     }
 
     Y yIn(current.getPosition(), current.getDirection());
+    Vector3d B;
+    if (not candidate->getCachedField(field, yIn.x, B)) {
+        B = field->getField(yIn.x);
+        candidate->setCachedField(field, yIn.x, B);
+    }
+    Y dydt = dYdt(yIn, current, B);
     Y yOut, yErr;
     double h = step / c_light;
     double hTry, r;
@@ -92,7 +98,7 @@ void PropagationCK::process(Candidate *candidate) const {
     int counter = 0;
     do {
         hTry = h;
-        tryStep(yIn, yOut, yErr, hTry, current);
+        tryStep(yIn, dydt, yOut, yErr, hTry, current);
 
         // determine absolute direction error relative to tolerance
         r = yErr.u.getR() / tolerance;
@@ -108,7 +114,7 @@ void PropagationCK::process(Candidate *candidate) const {
         }
         counter++;
 
-    } while (r > 1 && h > minStep);
+    } while (r > 1 && h * c_light > minStep);
 
     current.setPosition(yOut.x);
     current.setDirection(yOut.u.getUnitVector());
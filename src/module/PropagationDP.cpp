@@ -0,0 +1,181 @@
+#include "grpropa/module/PropagationDP.h"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace grpropa {
+
+// Dormand-Prince 5(4) coefficients
+static const double dormand_prince_a[7][6] = {
+    { 0., 0., 0., 0., 0., 0. },
+    { 1. / 5., 0., 0., 0., 0., 0. },
+    { 3. / 40., 9. / 40., 0., 0., 0., 0. },
+    { 44. / 45., -56. / 15., 32. / 9., 0., 0., 0. },
+    { 19372. / 6561., -25360. / 2187., 64448. / 6561., -212. / 729., 0., 0. },
+    { 9017. / 3168., -355. / 33., 46732. / 5247., 49. / 176., -5103. / 18656., 0. },
+    { 35. / 384., 0., 500. / 1113., 125. / 192., -2187. / 6784., 11. / 84. } };
+
+// difference of the 5th and 4th order weights, the 5th order weights are the last row of a
+static const double dormand_prince_e[7] = { 71. / 57600., 0., -71. / 16695., 71. / 1920., -17253. / 339200., 22. / 525., -1. / 40. };
+
+// exponents of the proportional-integral step size controller (Hairer & Wanner)
+static const double dormand_prince_alpha = 0.7 / 5;
+static const double dormand_prince_beta = 0.4 / 5;
+
+void PropagationDP::tryStep(const Y &y, const Y &dydt, Y &out, Vector3d &fieldOut, Y &error, double h, ParticleState &particle) const {
+    Y k[7];
+    k[0] = dydt;
+
+    for (size_t i = 1; i < 7; i++) {
+        Y y_n = y;
+        for (size_t j = 0; j < i; j++)
+            y_n += k[j] * (dormand_prince_a[i][j] * h);
+        Vector3d B = field->getField(y_n.x);
+        k[i] = dYdt(y_n, particle, B);
+        if (i == 6) {
+            // the last stage is evaluated at the 5th order solution
+            out = y_n;
+            fieldOut = B;
+        }
+    }
+
+    error = Y(0);
+    for (size_t i = 0; i < 7; i++)
+        error += k[i] * (dormand_prince_e[i] * h);
+}
+
+PropagationDP::Y PropagationDP::dYdt(const Y &y, ParticleState &p) const {
+    return dYdt(y, p, field->getField(y.x));
+}
+
+PropagationDP::Y PropagationDP::dYdt(const Y &y, ParticleState &p, const Vector3d &B) const {
+    // normalize direction vector to prevent numerical losses
+    Vector3d velocity = y.u.getUnitVector() * c_light;
+    // Lorentz force: du/dt = q*c/E * (v x B)
+    Vector3d dudt = p.getCharge() * c_light / p.getEnergy() * velocity.cross(B);
+    return Y(velocity, dudt);
+}
+
+PropagationDP::PropagationDP(ref_ptr<MagneticField> field, double tolerance, double minStep, double maxStep, int nMax) :
+        minStep(0) {
+    setField(field);
+    setTolerance(tolerance);
+    setMaximumStep(maxStep);
+    setMinimumStep(minStep);
+    nMaxIterations = nMax;
+}
+
+void PropagationDP::process(Candidate *candidate) const {
+    // save the new previous particle state
+    ParticleState &current = candidate->current;
+    candidate->previous = current;
+
+    double step = clip(candidate->getNextStep(), minStep, maxStep);
+
+    // rectilinear propagation for neutral particles
+    if (current.getCharge() == 0) {
+        Vector3d pos = current.getPosition();
+        Vector3d dir = current.getDirection();
+        current.setPosition(pos + dir * step);
+        candidate->setCurrentStep(step);
+        candidate->setNextStep(maxStep);
+        return;
+    }
+
+    Y yIn(current.getPosition(), current.getDirection());
+    Vector3d B, BOut;
+    if (not candidate->getCachedField(field, yIn.x, B)) {
+        B = field->getField(yIn.x);
+        candidate->setCachedField(field, yIn.x, B);
+    }
+    Y dydt = dYdt(yIn, current, B);
+    Y yOut, yErr;
+    double h = step / c_light;
+    double hTry, r;
+
+    // try performing a steps until the relative error is less than the desired
+    // tolerance or the minimum step size has been reached
+    int counter = 0;
+    while (true) {
+        hTry = h;
+        tryStep(yIn, dydt, yOut, BOut, yErr, hTry, current);
+
+        // determine absolute direction error relative to tolerance
+        r = yErr.u.getR() / tolerance;
+
+        if ((r <= 1) or (hTry * c_light <= minStep))
+            break;
+
+        // rejected: shrink the step without memory of the previous error
+        h = std::max(0.9 * pow(r, -0.2), 0.2) * hTry;
+        h = std::max(h, minStep / c_light);
+
+        // stop tracking particles that do not reach the desired tolerance
+        if (counter == nMaxIterations) {
+            candidate->setActive(false);
+            return;
+        }
+        counter++;
+    }
+
+    // accepted: proportional-integral control of the next step
+    r = std::max(r, 1e-4);
+    h = 0.9 * hTry * pow(r, -dormand_prince_alpha) * pow(candidate->getStepError(), dormand_prince_beta);
+    h = clip(h, 0.2 * hTry, 5 * hTry);
+
+    current.setPosition(yOut.x);
+    current.setDirection(yOut.u.getUnitVector());
+    candidate->setCachedField(field, yOut.x, BOut);
+    candidate->setStepError(r);
+    candidate->setCurrentStep(hTry * c_light);
+    candidate->setNextStep(h * c_light);
+}
+
+void PropagationDP::setField(ref_ptr<MagneticField> f) {
+    field = f;
+}
+
+void PropagationDP::setTolerance(double tol) {
+    if ((tol > 1) or (tol < 0))
+        throw std::runtime_error("PropagationDP: target error not in range 0-1");
+    tolerance = tol;
+}
+
+void PropagationDP::setMinimumStep(double min) {
+    if (min < 0)
+        throw std::runtime_error("PropagationDP: minStep < 0 ");
+    if (min > maxStep)
+        throw std::runtime_error("PropagationDP: minStep > maxStep");
+    minStep = min;
+}
+
+void PropagationDP::setMaximumStep(double max) {
+    if (max < minStep)
+        throw std::runtime_error("PropagationDP: maxStep < minStep");
+    maxStep = max;
+}
+
+double PropagationDP::getTolerance() const {
+    return tolerance;
+}
+
+double PropagationDP::getMinimumStep() const {
+    return minStep;
+}
+
+double PropagationDP::getMaximumStep() const {
+    return maxStep;
+}
+
+std::string PropagationDP::getDescription() const {
+    std::stringstream s;
+    s << "Propagation in magnetic fields using the Dormand-Prince method.";
+    s << " Target error: " << tolerance;
+    s << ", Minimum Step: " << minStep / kpc << " kpc";
+    s << ", Maximum Step: " << maxStep / kpc << " kpc";
+    return s.str();
+}
+
+} // namespace grpropa
@@ -0,0 +1,197 @@
+#include "grpropa/module/PropagationGuidingCenter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+namespace grpropa {
+
+PropagationGuidingCenter::PropagationGuidingCenter(ref_ptr<MagneticField> field, ref_ptr<Module> orbitPropagation, double adiabaticity, double accuracy, double minStep, double maxStep) :
+        minStep(0) {
+    setField(field);
+    setOrbitPropagation(orbitPropagation);
+    setAdiabaticity(adiabaticity);
+    setAccuracy(accuracy);
+    setMaximumStep(maxStep);
+    setMinimumStep(minStep);
+}
+
+PropagationGuidingCenter::State PropagationGuidingCenter::derivative(const State &s, double rg, double &scale, Vector3d &b, double &B) const {
+    Vector3d B0 = field->getField(s.R);
+    B = B0.getR();
+    b = B0 / B;
+
+    // finite differences over one gyroradius
+    double delta = std::abs(rg) / B;
+    Vector3d gradB;
+    gradB.x = (field->getField(s.R + Vector3d(delta, 0, 0)).getR() - field->getField(s.R - Vector3d(delta, 0, 0)).getR()) / (2 * delta);
+    gradB.y = (field->getField(s.R + Vector3d(0, delta, 0)).getR() - field->getField(s.R - Vector3d(0, delta, 0)).getR()) / (2 * delta);
+    gradB.z = (field->getField(s.R + Vector3d(0, 0, delta)).getR() - field->getField(s.R - Vector3d(0, 0, delta)).getR()) / (2 * delta);
+    Vector3d bPlus = field->getField(s.R + b * delta);
+    Vector3d bMinus = field->getField(s.R - b * delta);
+    Vector3d curvature = (bPlus / bPlus.getR() - bMinus / bMinus.getR()) / (2 * delta);
+
+    double inverseScale = std::max(gradB.getR() / B, curvature.getR());
+    scale = (inverseScale > 0) ? 1 / inverseScale : std::numeric_limits<double>::infinity();
+
+    // dR/ds = mu b + r_g / B [(1 - mu^2) / 2 (b x grad B) / B + mu^2 (b x curvature)]
+    // dmu/ds = -(1 - mu^2) / (2 B) (b . grad B)
+    double sin2 = 1 - s.mu * s.mu;
+    State d;
+    d.R = b * s.mu + (b.cross(gradB) * (sin2 / 2 / B) + b.cross(curvature) * (s.mu * s.mu)) * (rg / B);
+    d.mu = -sin2 / (2 * B) * b.dot(gradB);
+    return d;
+}
+
+void PropagationGuidingCenter::process(Candidate *candidate) const {
+    ParticleState &current = candidate->current;
+    Vector3d x = current.getPosition();
+    Vector3d u = current.getDirection();
+
+    // rectilinear propagation for neutral particles
+    if (current.getCharge() == 0) {
+        candidate->previous = current;
+        double step = clip(candidate->getNextStep(), minStep, maxStep);
+        current.setPosition(x + u * step);
+        candidate->setCurrentStep(step);
+        candidate->setNextStep(maxStep);
+        return;
+    }
+
+    Vector3d B0 = field->getField(x);
+    if (B0.getR2() == 0) {
+        orbitPropagation->process(candidate);
+        return;
+    }
+
+    // guiding center from the particle: R = x + E / (q c B^2) (u x B)
+    double rg = current.getEnergy() / (current.getCharge() * c_light); // r_g * B, with sign
+    State s0;
+    s0.R = x + u.cross(B0) * (rg / B0.getR2());
+    s0.mu = u.dot(B0) / B0.getR();
+
+    double scale, B;
+    Vector3d b;
+    State k1 = derivative(s0, rg, scale, b, B);
+    double BR0 = B; // field strength at the initial guiding center
+
+    // not adiabatic: full orbit
+    if (std::abs(rg) / B > adiabaticity * scale) {
+        orbitPropagation->process(candidate);
+        return;
+    }
+
+    candidate->previous = current;
+    double step = clip(candidate->getNextStep(), minStep, maxStep);
+    step = std::max(std::min(step, accuracy * scale), minStep);
+
+    // Runge-Kutta 4
+    State s, k2, k3, k4;
+    s.R = s0.R + k1.R * (step / 2);
+    s.mu = s0.mu + k1.mu * (step / 2);
+    k2 = derivative(s, rg, scale, b, B);
+    s.R = s0.R + k2.R * (step / 2);
+    s.mu = s0.mu + k2.mu * (step / 2);
+    k3 = derivative(s, rg, scale, b, B);
+    s.R = s0.R + k3.R * step;
+    s.mu = s0.mu + k3.mu * step;
+    k4 = derivative(s, rg, scale, b, B);
+    double nextScale = scale; // length scale of the last stage, close to the new guiding center
+
+    State s1;
+    s1.R = s0.R + (k1.R + k2.R * 2 + k3.R * 2 + k4.R) * (step / 6);
+    s1.mu = s0.mu + (k1.mu + 2 * k2.mu + 2 * k3.mu + k4.mu) * (step / 6);
+
+    // conserve the magnetic moment: 1 - mu^2 proportional to B at the guiding center
+    Vector3d B1 = field->getField(s1.R);
+    B = B1.getR();
+    b = B1 / B;
+    double sin2 = (1 - s0.mu * s0.mu) * B / BR0;
+    if (sin2 >= 1) {
+        s1.mu = 0; // mirror point
+        sin2 = 1;
+    } else {
+        s1.mu = ((s1.mu >= 0) ? 1 : -1) * sqrt(1 - sin2);
+    }
+
+    // particle direction: perpendicular part of the old direction, projected and rotated by the gyration phase
+    Vector3d perp = u - b * u.dot(b);
+    if (perp.getR2() == 0)
+        perp = b.cross(std::abs(b.x) < 0.9 ? Vector3d(1, 0, 0) : Vector3d(0, 1, 0));
+    perp /= perp.getR();
+    double phase = -step * B / rg; // du/ds = q c / E (u x B)
+    perp = perp * cos(phase) + b.cross(perp) * sin(phase);
+    Vector3d uNew = b * s1.mu + perp * sqrt(sin2);
+
+    // particle position: x = R - E / (q c B) (u x b)
+    current.setPosition(s1.R - uNew.cross(b) * (rg / B));
+    current.setDirection(uNew.getUnitVector());
+    candidate->setCurrentStep(step);
+    candidate->setNextStep(clip(accuracy * nextScale, minStep, maxStep));
+}
+
+void PropagationGuidingCenter::setField(ref_ptr<MagneticField> f) {
+    field = f;
+}
+
+void PropagationGuidingCenter::setOrbitPropagation(ref_ptr<Module> propagation) {
+    if (!propagation)
+        throw std::runtime_error("PropagationGuidingCenter: orbit propagation module required");
+    orbitPropagation = propagation;
+}
+
+void PropagationGuidingCenter::setAdiabaticity(double a) {
+    if (a <= 0)
+        throw std::runtime_error("PropagationGuidingCenter: adiabaticity <= 0");
+    adiabaticity = a;
+}
+
+void PropagationGuidingCenter::setAccuracy(double a) {
+    if (a <= 0)
+        throw std::runtime_error("PropagationGuidingCenter: accuracy <= 0");
+    accuracy = a;
+}
+
+void PropagationGuidingCenter::setMinimumStep(double min) {
+    if (min < 0)
+        throw std::runtime_error("PropagationGuidingCenter: minStep < 0 ");
+    if (min > maxStep)
+        throw std::runtime_error("PropagationGuidingCenter: minStep > maxStep");
+    minStep = min;
+}
+
+void PropagationGuidingCenter::setMaximumStep(double max) {
+    if (max < minStep)
+        throw std::runtime_error("PropagationGuidingCenter: maxStep < minStep");
+    maxStep = max;
+}
+
+double PropagationGuidingCenter::getAdiabaticity() const {
+    return adiabaticity;
+}
+
+double PropagationGuidingCenter::getAccuracy() const {
+    return accuracy;
+}
+
+double PropagationGuidingCenter::getMinimumStep() const {
+    return minStep;
+}
+
+double PropagationGuidingCenter::getMaximumStep() const {
+    return maxStep;
+}
+
+std::string PropagationGuidingCenter::getDescription() const {
+    std::stringstream s;
+    s << "Guiding center propagation for r_g below " << adiabaticity << " field length scales";
+    s << ", Accuracy: " << accuracy;
+    s << ", Minimum Step: " << minStep / kpc << " kpc";
+    s << ", Maximum Step: " << maxStep / kpc << " kpc";
+    s << ", otherwise " << orbitPropagation->getDescription();
+    return s.str();
+}
+
+} // namespace grpropa
@@ -0,0 +1,213 @@
+#include "grpropa/module/PropagationHelix.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace grpropa {
+
+// relative overshoot past a cell face, so that the next step starts in the next cell
+static const double cellOvershoot = 1e-9;
+
+PropagationHelix::PropagationHelix(ref_ptr<MagneticField> field, double minStep, double maxStep) :
+        minStep(0) {
+    setField(field);
+    setMaximumStep(maxStep);
+    setMinimumStep(minStep);
+}
+
+void PropagationHelix::helixStep(Vector3d &x, Vector3d &u, const Vector3d &B, double k, double step) {
+    double b = B.getR();
+    if ((b == 0) or (k == 0)) {
+        x += u * step;
+        return;
+    }
+
+    // u(s) = u_par + u_perp cos(ws) + (u_perp x n) sin(ws), with n = B / |B| and w = k |B|
+    Vector3d n = B / b;
+    double w = k * b;
+    Vector3d uPar = n * u.dot(n);
+    Vector3d uPerp = u - uPar;
+    Vector3d uCross = uPerp.cross(n);
+    double phase = w * step;
+    double sinPhase = sin(phase);
+    double cosPhase = cos(phase);
+
+    x += uPar * step + uPerp * (sinPhase / w) + uCross * ((1 - cosPhase) / w);
+    u = uPar + uPerp * cosPhase + uCross * sinPhase;
+}
+
+// First s in [0, smax] at which the coordinate x(s) = x0 + a s + (p sin(ws) + q (1 - cos(ws))) / w leaves [lo, hi],
+// smax if it does not. x0 has to be in [lo, hi] and w > 0.
+// x(s) is monotonic between the zeros of x'(s) = a + p cos(ws) + q sin(ws), so these are visited in order
+// and the crossing is bisected in the first interval that ends outside.
+static double coordinateExit(double x0, double a, double p, double q, double w, double lo, double hi, double smax) {
+    double amplitude = sqrt(p * p + q * q);
+
+    // window in which the envelope x0 + a s + (q +- amplitude) / w crosses the faces
+    double upper = (q + amplitude) / w;
+    double lower = (q - amplitude) / w;
+    double sStart = 0;
+    double sEnd = smax;
+    if (a > 0) {
+        if (x0 + lower > lo)
+            sStart = std::max((hi - x0 - upper) / a, 0.);
+        sEnd = std::min((hi - x0 - lower) / a, smax);
+    } else if (a < 0) {
+        if (x0 + upper < hi)
+            sStart = std::max((lo - x0 - lower) / a, 0.);
+        sEnd = std::min((lo - x0 - upper) / a, smax);
+    } else if ((x0 + upper < hi) and (x0 + lower > lo))
+        return smax; // oscillation fits into the cell
+    if (sStart >= smax)
+        return smax;
+
+    // zeros of x'(s): ws = phi +- alpha (mod 2 pi)
+    double phi = atan2(q, p);
+    double alpha = (std::abs(a) < amplitude) ? acos(-a / amplitude) : -1;
+
+    double s0 = sStart;
+    for (int i = 0; i < 10000; i++) {
+        // next zero of x'(s) after s0, or the end of the window
+        double s1 = sEnd;
+        if (alpha >= 0) {
+            double theta = w * s0;
+            for (int sign = -1; sign <= 1; sign += 2) {
+                double base = phi + sign * alpha;
+                double n = floor((theta - base) / (2 * M_PI)) + 1;
+                s1 = std::min(s1, (base + 2 * M_PI * n) / w);
+            }
+        }
+
+        double x1 = x0 + a * s1 + (p * sin(w * s1) + q * (1 - cos(w * s1))) / w;
+        if ((x1 < lo) or (x1 > hi)) {
+            // bisect the crossing in [s0, s1]
+            double face = (x1 < lo) ? lo : hi;
+            double sign = (x1 < lo) ? -1 : 1;
+            for (int j = 0; j < 60; j++) {
+                double s = (s0 + s1) / 2;
+                double x = x0 + a * s + (p * sin(w * s) + q * (1 - cos(w * s))) / w;
+                if (sign * (x - face) > 0)
+                    s1 = s;
+                else
+                    s0 = s;
+            }
+            return s1;
+        }
+        if (s1 >= sEnd)
+            return sEnd;
+        s0 = s1;
+    }
+    return s0; // not resolved, stop where the cell is known not to be left
+}
+
+double PropagationHelix::distanceToCellExit(const Vector3d &x, const Vector3d &u, const Vector3d &B, double k, double smax) const {
+    // cells of the closest grid point are bounded by origin + i * spacing
+    double spacing = grid->getSpacing();
+    Vector3d r = (x - grid->getOrigin()) / spacing;
+    Vector3d lo = r.floor() * spacing;
+    Vector3d hi = lo + Vector3d(spacing);
+    Vector3d x0 = r * spacing;
+
+    // helix in the form x0 + a s + (p sin(ws) + q (1 - cos(ws))) / w per coordinate, see helixStep
+    Vector3d a = u;
+    Vector3d p(0.), q(0.);
+    double b = B.getR();
+    double w = std::abs(k) * b;
+    if (w > 0) {
+        Vector3d n = B / b;
+        a = n * u.dot(n);
+        p = u - a;
+        q = p.cross(n) * ((k > 0) ? 1 : -1);
+    } else {
+        w = 1; // straight line, p = q = 0
+    }
+
+    double s = smax;
+    s = std::min(s, coordinateExit(x0.x, a.x, p.x, q.x, w, lo.x, hi.x, s));
+    s = std::min(s, coordinateExit(x0.y, a.y, p.y, q.y, w, lo.y, hi.y, s));
+    s = std::min(s, coordinateExit(x0.z, a.z, p.z, q.z, w, lo.z, hi.z, s));
+    return s;
+}
+
+void PropagationHelix::process(Candidate *candidate) const {
+    // save the new previous particle state
+    ParticleState &current = candidate->current;
+    candidate->previous = current;
+
+    double step = clip(candidate->getNextStep(), minStep, maxStep);
+    Vector3d x = current.getPosition();
+    Vector3d u = current.getDirection();
+
+    // rectilinear propagation for neutral particles
+    if (current.getCharge() == 0) {
+        current.setPosition(x + u * step);
+        candidate->setCurrentStep(step);
+        candidate->setNextStep(maxStep);
+        return;
+    }
+
+    Vector3d B = field->getField(x);
+    double k = current.getCharge() * c_light / current.getEnergy();
+
+    // stop at the face of a grid cell, slightly inside the next one
+    if (grid) {
+        double exit = distanceToCellExit(x, u, B, k, step);
+        if (exit < step)
+            step = exit + cellOvershoot * grid->getSpacing();
+    }
+
+    helixStep(x, u, B, k, step);
+    current.setPosition(x);
+    current.setDirection(u.getUnitVector());
+    candidate->setCurrentStep(step);
+    candidate->setNextStep(maxStep);
+}
+
+void PropagationHelix::setField(ref_ptr<MagneticField> f) {
+    if (dynamic_cast<UniformMagneticField *>(f.get())) {
+        grid = NULL;
+    } else if (MagneticFieldGrid *g = dynamic_cast<MagneticFieldGrid *>(f.get())) {
+        if (not g->isNearestCell())
+            throw std::runtime_error("PropagationHelix: MagneticFieldGrid has to be in nearest-cell mode");
+        if (not g->getGrid())
+            throw std::runtime_error("PropagationHelix: only MagneticFieldGrids of a VectorGrid are supported");
+        grid = g->getGrid();
+    } else {
+        throw std::runtime_error("PropagationHelix: field has to be uniform or a MagneticFieldGrid in nearest-cell mode");
+    }
+    field = f;
+}
+
+void PropagationHelix::setMinimumStep(double min) {
+    if (min < 0)
+        throw std::runtime_error("PropagationHelix: minStep < 0 ");
+    if (min > maxStep)
+        throw std::runtime_error("PropagationHelix: minStep > maxStep");
+    minStep = min;
+}
+
+void PropagationHelix::setMaximumStep(double max) {
+    if (max < minStep)
+        throw std::runtime_error("PropagationHelix: maxStep < minStep");
+    maxStep = max;
+}
+
+double PropagationHelix::getMinimumStep() const {
+    return minStep;
+}
+
+double PropagationHelix::getMaximumStep() const {
+    return maxStep;
+}
+
+std::string PropagationHelix::getDescription() const {
+    std::stringstream s;
+    s << "Propagation along helices in " << (grid ? "a nearest-cell field grid" : "a uniform magnetic field");
+    s << ", Minimum Step: " << minStep / kpc << " kpc";
+    s << ", Maximum Step: " << maxStep / kpc << " kpc";
+    return s.str();
+}
+
+} // namespace grpropa
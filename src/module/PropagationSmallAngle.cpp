@@ -0,0 +1,143 @@
+#include "grpropa/module/PropagationSmallAngle.h"
+#include "grpropa/Random.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+namespace grpropa {
+
+PropagationSmallAngle::PropagationSmallAngle(ref_ptr<MagneticField> field, double correlationLength, double maxAngle, double minStep, double maxStep) :
+        minStep(0) {
+    setField(field);
+    setCorrelationLength(correlationLength);
+    setMaximumAngle(maxAngle);
+    setMaximumStep(maxStep);
+    setMinimumStep(minStep);
+}
+
+double PropagationSmallAngle::deflectionAngle(double step, double rg) const {
+    if (step <= correlationLength)
+        return step / rg;
+    return sqrt(2. / 3. * step * correlationLength) / rg;
+}
+
+void PropagationSmallAngle::process(Candidate *candidate) const {
+    // save the new previous particle state
+    ParticleState &current = candidate->current;
+    candidate->previous = current;
+
+    double step = clip(candidate->getNextStep(), minStep, maxStep);
+    Vector3d pos = current.getPosition();
+    Vector3d dir = current.getDirection();
+
+    // rectilinear propagation for neutral particles
+    if (current.getCharge() == 0) {
+        current.setPosition(pos + dir * step);
+        candidate->setCurrentStep(step);
+        candidate->setNextStep(maxStep);
+        return;
+    }
+
+    Vector3d B = field->getField(pos);
+    double b = B.getR();
+    if (b == 0) {
+        current.setPosition(pos + dir * step);
+        candidate->setCurrentStep(step);
+        candidate->setNextStep(maxStep);
+        return;
+    }
+    double rg = current.getEnergy() / (std::abs(current.getCharge()) * c_light * b);
+
+    // largest step with an expected deflection below the maximum angle
+    double stepMax = maxAngle * rg;
+    if (stepMax > correlationLength)
+        stepMax = 1.5 * pow(maxAngle * rg, 2) / correlationLength;
+    step = std::min(step, stepMax);
+
+    if (step <= correlationLength) {
+        // coherent rotation about the local field, du/ds = q c / E (u x B)
+        Vector3d n = B / b;
+        double angle = -step / rg * ((current.getCharge() > 0) ? 1 : -1);
+        Vector3d uPar = n * dir.dot(n);
+        Vector3d uPerp = dir - uPar;
+        Vector3d uRot = uPar + uPerp * cos(angle) + n.cross(uPerp) * sin(angle);
+        current.setPosition(pos + (dir + uRot).getUnitVector() * step);
+        current.setDirection(uRot.getUnitVector());
+    } else {
+        // random walk of the direction through step / correlationLength cells:
+        // per perpendicular component theta = sigma * g1 and the lateral offset s (theta / 2 + sigma * g2 / sqrt(12))
+        Random &random = Random::instance();
+        double sigma = deflectionAngle(step, rg) / sqrt(2.);
+        Vector3d e1 = dir.cross(std::abs(dir.x) < 0.9 ? Vector3d(1, 0, 0) : Vector3d(0, 1, 0));
+        e1 /= e1.getR();
+        Vector3d e2 = dir.cross(e1);
+        double theta1 = sigma * random.randNorm();
+        double theta2 = sigma * random.randNorm();
+        double offset1 = step * (theta1 / 2 + sigma * random.randNorm() / sqrt(12.));
+        double offset2 = step * (theta2 / 2 + sigma * random.randNorm() / sqrt(12.));
+        current.setPosition(pos + dir * step + e1 * offset1 + e2 * offset2);
+        current.setDirection((dir + e1 * theta1 + e2 * theta2).getUnitVector());
+    }
+
+    candidate->setCurrentStep(step);
+    candidate->setNextStep(maxStep);
+}
+
+void PropagationSmallAngle::setField(ref_ptr<MagneticField> f) {
+    field = f;
+}
+
+void PropagationSmallAngle::setCorrelationLength(double l) {
+    if (l <= 0)
+        throw std::runtime_error("PropagationSmallAngle: correlation length <= 0");
+    correlationLength = l;
+}
+
+void PropagationSmallAngle::setMaximumAngle(double angle) {
+    if (angle <= 0)
+        throw std::runtime_error("PropagationSmallAngle: maximum angle <= 0");
+    maxAngle = angle;
+}
+
+void PropagationSmallAngle::setMinimumStep(double min) {
+    if (min < 0)
+        throw std::runtime_error("PropagationSmallAngle: minStep < 0 ");
+    if (min > maxStep)
+        throw std::runtime_error("PropagationSmallAngle: minStep > maxStep");
+    minStep = min;
+}
+
+void PropagationSmallAngle::setMaximumStep(double max) {
+    if (max < minStep)
+        throw std::runtime_error("PropagationSmallAngle: maxStep < minStep");
+    maxStep = max;
+}
+
+double PropagationSmallAngle::getCorrelationLength() const {
+    return correlationLength;
+}
+
+double PropagationSmallAngle::getMaximumAngle() const {
+    return maxAngle;
+}
+
+double PropagationSmallAngle::getMinimumStep() const {
+    return minStep;
+}
+
+double PropagationSmallAngle::getMaximumStep() const {
+    return maxStep;
+}
+
+std::string PropagationSmallAngle::getDescription() const {
+    std::stringstream s;
+    s << "Propagation with small-angle deflections, correlation length: " << correlationLength / kpc << " kpc";
+    s << ", Maximum angle: " << maxAngle;
+    s << ", Minimum Step: " << minStep / kpc << " kpc";
+    s << ", Maximum Step: " << maxStep / kpc << " kpc";
+    return s.str();
+}
+
+} // namespace grpropa
@@ -6,6 +6,14 @@
 
 namespace grpropa {
 
+void Redshift::updateCosmicTime(Candidate *c, double z0, double z1, double step) {
+    double speed = c->current.getSpeed();
+    double dt = step / (1 + (z0 + z1) / 2) / speed; // d(light travel distance) = d(comoving distance) / (1 + z)
+    if (z0 - z1 > 0.01)
+        dt = (redshift2LightTravelDistance(z0) - redshift2LightTravelDistance(z1)) / speed;
+    c->setCosmicTime(c->getCosmicTime() - step / speed + dt);
+}
+
 void Redshift::process(Candidate *c) const {
     double z = c->getRedshift();
 
@@ -13,18 +21,18 @@ void Redshift::process(Candidate *c) const {
     if (z <= std::numeric_limits<double>::min())
         return;
 
-    // use small step approximation:  dz = H(z) / c * ds
-    double dz = hubbleRate(z) / c_light * c->getCurrentStep();
-
-    // prevent dz > z
-    dz = std::min(dz, z);
+    // exact for long steps, see redshiftAfterComovingDistance
+    double step = c->getCurrentStep();
+    double znew = redshiftAfterComovingDistance(z, step);
 
     // update redshift
-    c->setRedshift(z - dz);
+    c->setRedshift(znew);
 
-    // adiabatic energy loss: dE / dz = E / (1 + z)
+    updateCosmicTime(c, z, znew, step);
+
+    // adiabatic energy loss: E ~ (1 + z)
     double E = c->current.getEnergy();
-    c->current.setEnergy(E * (1 - dz / (1 + z)));
+    c->current.setEnergy(E * (1 + znew) / (1 + z));
 }
 
 std::string Redshift::getDescription() const {
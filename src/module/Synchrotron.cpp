@@ -1,16 +1,163 @@
 #include "grpropa/module/Synchrotron.h"
 #include "grpropa/Units.h"
+#include "grpropa/Common.h"
+#include "grpropa/Random.h"
 #include "grpropa/Cosmology.h"
 #include "grpropa/magneticField/MagneticField.h"
 
+#include <cmath>
+#include <fstream>
 #include <limits>
+#include <stdexcept>
 
 namespace grpropa {
 
-Synchrotron::Synchrotron(ref_ptr<MagneticField> field, double limit) 
+SynchrotronHistogram::SynchrotronHistogram(double Emin, double Emax, size_t nEnergy, size_t nCosTheta, size_t nPhi) :
+        Emin(Emin), Emax(Emax), nEnergy(nEnergy), nCosTheta(nCosTheta), nPhi(nPhi) {
+    if ((Emin <= 0) or (Emax <= Emin))
+        throw std::runtime_error("SynchrotronHistogram: invalid energy range");
+    if ((nEnergy == 0) or (nCosTheta == 0) or (nPhi == 0))
+        throw std::runtime_error("SynchrotronHistogram: number of bins must be positive");
+    bins.resize(nEnergy * nCosTheta * nPhi, 0);
+}
+
+double SynchrotronHistogram::getEnergyEdge(size_t i) const {
+    return Emin * pow(Emax / Emin, double(i) / nEnergy);
+}
+
+size_t SynchrotronHistogram::getNumberOfEnergyBins() const {
+    return nEnergy;
+}
+
+size_t SynchrotronHistogram::getNumberOfDirectionBins() const {
+    return nCosTheta * nPhi;
+}
+
+size_t SynchrotronHistogram::getDirectionBin(const Vector3d &direction) const {
+    double cosTheta = direction.z / direction.getR();
+    double phi = atan2(direction.y, direction.x) + M_PI;
+    size_t iCosTheta = std::min(size_t((cosTheta + 1) / 2 * nCosTheta), nCosTheta - 1);
+    size_t iPhi = std::min(size_t(phi / (2 * M_PI) * nPhi), nPhi - 1);
+    return iCosTheta * nPhi + iPhi;
+}
+
+void SynchrotronHistogram::add(size_t iEnergy, size_t iDirection, double energy) {
+    double &bin = bins[iEnergy * nCosTheta * nPhi + iDirection];
+#pragma omp atomic
+    bin += energy;
+}
+
+double SynchrotronHistogram::getEmittedEnergy(size_t iEnergy, size_t iDirection) const {
+    return bins[iEnergy * nCosTheta * nPhi + iDirection];
+}
+
+std::vector<double> SynchrotronHistogram::getSpectrum() const {
+    size_t nDirection = nCosTheta * nPhi;
+    std::vector<double> spectrum(nEnergy, 0);
+    for (size_t i = 0; i < nEnergy; i++)
+        for (size_t j = 0; j < nDirection; j++)
+            spectrum[i] += bins[i * nDirection + j];
+    return spectrum;
+}
+
+std::vector<double> SynchrotronHistogram::getAngularDistribution() const {
+    size_t nDirection = nCosTheta * nPhi;
+    std::vector<double> distribution(nDirection, 0);
+    for (size_t i = 0; i < nEnergy; i++)
+        for (size_t j = 0; j < nDirection; j++)
+            distribution[j] += bins[i * nDirection + j];
+    return distribution;
+}
+
+void SynchrotronHistogram::clear() {
+    std::fill(bins.begin(), bins.end(), 0);
+}
+
+void SynchrotronHistogram::dump(std::string filename) const {
+    std::ofstream outfile(filename.c_str());
+    if (!outfile)
+        throw std::runtime_error("SynchrotronHistogram: could not open file " + filename);
+    size_t nDirection = nCosTheta * nPhi;
+    outfile << "# Emin [eV]\tEmax [eV]\temitted energy [eV] per direction bin (cos(theta) major, phi minor)\n";
+    for (size_t i = 0; i < nEnergy; i++) {
+        outfile << getEnergyEdge(i) / eV << "\t" << getEnergyEdge(i + 1) / eV;
+        for (size_t j = 0; j < nDirection; j++)
+            outfile << "\t" << bins[i * nDirection + j] / eV;
+        outfile << "\n";
+    }
+}
+
+Synchrotron::Synchrotron(ref_ptr<MagneticField> field, double limit)
 {
     this->Bfield = field;
     this->limit = limit;
+    this->nPhotons = 0;
+    this->secondaryThreshold = 0;
+    initSpectrum();
+}
+
+void Synchrotron::setLimit(double limit) {
+    this->limit = limit;
+}
+
+void Synchrotron::setNumberOfPhotons(size_t nPhotons) {
+    this->nPhotons = nPhotons;
+}
+
+void Synchrotron::setSecondaryThreshold(double threshold) {
+    this->secondaryThreshold = threshold;
+}
+
+void Synchrotron::setHistogram(ref_ptr<SynchrotronHistogram> histogram) {
+    this->histogram = histogram;
+}
+
+ref_ptr<SynchrotronHistogram> Synchrotron::getHistogram() const {
+    return histogram;
+}
+
+double Synchrotron::synchrotronFunction(double x) {
+    // approximation of Aharonian, Kelner & Prosekin 2010, accurate to better than 0.2%
+    double x23 = pow(x, 2. / 3.);
+    double x43 = x23 * x23;
+    return 2.15 * pow(x, 1. / 3.) * pow(1 + 3.06 * x, 1. / 6.) * (1 + 0.884 * x23 + 0.471 * x43)
+            / (1 + 1.64 * x23 + 0.974 * x43) * exp(-x);
+}
+
+double Synchrotron::criticalEnergy(double lorentzFactor, double Bperp) {
+    double hbar = h_planck / (2 * M_PI);
+    return 1.5 * hbar * lorentzFactor * lorentzFactor * eplus * Bperp / mass_electron;
+}
+
+void Synchrotron::initSpectrum() {
+    // cumulative emitted energy, integral of F(x) in ln(x)
+    const size_t n = 1000;
+    const double xmin = 1e-6;
+    const double xmax = 40;
+    double dlx = log(xmax / xmin) / (n - 1);
+    tabX.resize(n);
+    tabCDF.resize(n);
+    tabX[0] = xmin;
+    tabCDF[0] = 0;
+    double fPrev = synchrotronFunction(xmin) * xmin;
+    for (size_t i = 1; i < n; i++) {
+        tabX[i] = xmin * exp(i * dlx);
+        double f = synchrotronFunction(tabX[i]) * tabX[i];
+        tabCDF[i] = tabCDF[i - 1] + (f + fPrev) / 2 * dlx;
+        fPrev = f;
+    }
+    for (size_t i = 0; i < n; i++)
+        tabCDF[i] /= tabCDF.back();
+}
+
+double Synchrotron::energyFraction(double x) const {
+    return interpolate(x, tabX, tabCDF);
+}
+
+double Synchrotron::samplePhotonEnergy(double xmin) const {
+    Random &random = Random::instance();
+    double u = random.randUniform(energyFraction(xmin), 1);
+    return interpolate(u, tabCDF, tabX);
 }
 
 void Synchrotron::process(Candidate *c) const {
@@ -22,15 +169,24 @@ void Synchrotron::process(Candidate *c) const {
     double E = c->current.getEnergy() * (1 + z);
     double lf = c->current.getLorentzFactor() * (1 + z);
     Vector3d pos = c->current.getPosition();
-    Vector3d b = Bfield->getField(pos);
+    Vector3d b;
+    if (not c->getCachedField(Bfield, pos, b)) {
+        b = Bfield->getField(pos);
+        c->setCachedField(Bfield, pos, b);
+    }
     Vector3d v = c->current.getVelocity();
     double beta = c->current.getSpeed() / c_light;
     double step = c->getCurrentStep() / (1 + z);
-    double B = b.getR() * pow(1 + z, 2);
 
-    double vperp = v.cross(b).getR() / B;
-    double RL = lf * mass_electron * vperp / (eplus * B);
-    double dEdx = (2. / 3.) * pow(eplus, 2) * pow(beta * lf, 4) / pow(RL, 2); 
+    // field component perpendicular to the motion
+    double Bperp = v.cross(b).getR() / v.getR() * pow(1 + z, 2);
+    if (Bperp == 0)
+        return;
+    double RL = lf * mass_electron * beta * c_light / (eplus * Bperp);
+
+    // Jackson eq. 14.31 with e^2 -> e^2 / (4 pi epsilon0) for SI units
+    double coulomb = mu0_vacPerm * c_squared / (4 * M_PI);
+    double dEdx = (2. / 3.) * coulomb * pow(eplus, 2) * pow(beta * lf, 4) / pow(RL, 2);
 
     double dE = std::abs(dEdx * step);
     dE = std::min(E, dE);
@@ -41,6 +197,41 @@ void Synchrotron::process(Candidate *c) const {
 
     c->current.setEnergy(Enew);
     c->limitNextStep(limit * E / dEdx);
+
+    if ((dE <= 0) or ((nPhotons == 0) and !histogram))
+        return;
+
+    double Ec = criticalEnergy(lf, Bperp);
+    double w0 = c->getWeight();
+
+    // histogram of the emitted energy, in the same energy units as the candidates
+    if (histogram) {
+        size_t iDirection = histogram->getDirectionBin(c->current.getDirection());
+        double lower = energyFraction(histogram->getEnergyEdge(0) * (1 + z) / Ec);
+        for (size_t i = 0; i < histogram->getNumberOfEnergyBins(); i++) {
+            double upper = energyFraction(histogram->getEnergyEdge(i + 1) * (1 + z) / Ec);
+            if (upper > lower)
+                histogram->add(i, iDirection, w0 * dE / (1 + z) * (upper - lower));
+            lower = upper;
+        }
+    }
+
+    // representative photons, weighted to carry the emitted energy above the threshold
+    if (nPhotons > 0) {
+        double xmin = secondaryThreshold * (1 + z) / Ec;
+        double fraction = 1 - energyFraction(xmin);
+        if (fraction <= 0)
+            return;
+
+        Random &random = Random::instance();
+        Vector3d pos0 = c->previous.getPosition();
+        for (size_t i = 0; i < nPhotons; i++) {
+            double Ephoton = samplePhotonEnergy(xmin) * Ec;
+            double w = w0 * dE * fraction / (nPhotons * Ephoton);
+            Vector3d emissionPos = pos0 + (pos - pos0) * random.rand();
+            c->addSecondary(22, Ephoton / (1 + z), emissionPos, w);
+        }
+    }
 }
 
 